@@ -7,72 +7,39 @@
 #include <time.h>
 #include <signal.h>
 
-#define MAX_POSITIVE_INT 10000
-#define MIN_NEGATIVE_INT -60
+#include "datascan.h"
+
 #define HIDDEN_KEYS_COUNT 60
 #define MAX_CHILDREN 4
 #define MAX_TREE_HEIGHT 3
-#define HIDDEN_KEY_LOWER_BOUND -60
-#define HIDDEN_KEY_UPPER_BOUND -1
 
 // Signal handler for SIGINT in child processes
 void sigint_handler(int signum) {
     printf("Received SIGINT. My PID is %d and my parent's PID is %d.\n", getpid(), getppid());
 }
 
-int *read_data(const char *filename, int *size) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
-
-    fscanf(file, "%d", size);
-    int *data = malloc((*size) * sizeof(int));
-    if (!data) {
-        perror("Malloc failed");
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < *size; ++i) {
-        if (fscanf(file, "%d", &data[i]) != 1) {
-            perror("Failed to read integer from file");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    fclose(file);
-    return data;
-}
-
-void process_data_segment(int *data, int start, int end, int process_id, int write_pipe) {
+void process_data_segment(const int *data, int start, int end, int process_id, int write_pipe) {
     printf("Child %d (PID: %d) started processing data segment from %d to %d.\n", process_id, getpid(), start, end); // Log when child starts
 
     clock_t begin = clock(); // Start the clock to measure processing time
 
-    int max = data[start];
-    int sum = 0, count_hidden = 0;
-    for (int i = start; i < end; ++i) {
-        if (data[i] > max) {
-            max = data[i];
-        }
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            count_hidden++;
-        }
-        sum += data[i];
+    struct scan_result result;
+    scan_result_init(&result);
+    if (scan_segment(data, start, end, &result) == -1) {
+        perror("scan_segment");
+        exit(EXIT_FAILURE);
     }
-    float avg = (end > start) ? (float)sum / (end - start) : 0.0;
+    int max = result.max;
+    float avg = (float)result.avg;
 
     clock_t end_clock = clock(); // End the clock
 
     // Calculate time taken in seconds
     double time_spent = (double)(end_clock - begin) / CLOCKS_PER_SEC;
 
-    for (int i = start; i < end; ++i) {
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            // Write to pipe when a key is found
-            write(write_pipe, &data[i], sizeof(int));
-        }
+    for (int k = 0; k < result.count_hidden; ++k) {
+        // Write to pipe when a key is found
+        write(write_pipe, &data[result.key_positions[k]], sizeof(int));
     }
 
     int fd = open("output-BFSp2.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
@@ -83,10 +50,9 @@ void process_data_segment(int *data, int start, int end, int process_id, int wri
 
     // Writing process data and findings to the file
     dprintf(fd, "Hi I'm process %d with return arg %d and my parent is %d.\n", process_id, max, getppid());
-    for (int i = start; i < end; ++i) {
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
-        }
+    for (int k = 0; k < result.count_hidden; ++k) {
+        int i = result.key_positions[k];
+        dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
     }
     dprintf(fd, "Max=%d, Avg=%.2f\n", max, avg);
 
@@ -96,6 +62,7 @@ void process_data_segment(int *data, int start, int end, int process_id, int wri
 
     close(fd);
     close(write_pipe); // Close the write end of the pipe
+    scan_result_free(&result);
 }
 
 // Rule 1: Send SIGCONT signal to child process
@@ -131,13 +98,10 @@ void rule_3(int child_pid) {
     kill(child_pid, SIGQUIT);
 }
 
-void bfs_process_data(int *data, int size, int current_level, int max_levels, int idx_in_level, int write_pipe, int parent_pid, int *hidden_counts, int *num_hidden) {
+void bfs_process_data(const int *data, int size, int current_level, int max_levels, int idx_in_level, int write_pipe, int parent_pid, int *hidden_counts, int *num_hidden) {
     int num_processes_at_max_level = 1 << max_levels; // Total number of processes at the max level
-    int base_segment_size = size / num_processes_at_max_level;
-    int remaining_elements = size % num_processes_at_max_level;
-
-    int start = idx_in_level * base_segment_size + (idx_in_level < remaining_elements ? idx_in_level : remaining_elements);
-    int end = start + base_segment_size + (idx_in_level < remaining_elements ? 1 : 0);
+    int start, end;
+    scan_segment_bounds(size, num_processes_at_max_level, idx_in_level, &start, &end);
 
     if (current_level == max_levels) {
         if (start < size) { // Ensure the process has data to process
@@ -244,7 +208,11 @@ int main(int argc, char *argv[]) {
     }
     
     int size;
-    int *data = read_data("input.txt", &size);
+    int *data = scan_read_file("input.txt", &size);
+    if (!data) {
+        perror("Error reading input.txt");
+        exit(EXIT_FAILURE);
+    }
 
     int pipefd[2];
     if (pipe(pipefd) == -1) {
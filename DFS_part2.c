@@ -7,13 +7,11 @@
 #include <time.h>
 #include <signal.h>
 
-#define MAX_POSITIVE_INT 10000
-#define MIN_NEGATIVE_INT -60
+#include "datascan.h"
+
 #define HIDDEN_KEYS_COUNT 60
 
-int *read_data(const char *filename, int *size);
-void process_data_segment(int *data, int start, int end, int child_idx, int write_pipe, int read_pipe);
-void generate_and_hide_keys(const char* filename, int L, int H);
+void process_data_segment(const int *data, int start, int end, int child_idx, int write_pipe, int read_pipe);
 void pause_child();
 void handle_sigcont(int signum);
 
@@ -32,7 +30,17 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    generate_and_hide_keys("input.txt", L, H);
+    int *numbers = malloc(L * sizeof(int));
+    if (!numbers) {
+        perror("Failed to allocate memory for numbers array");
+        exit(EXIT_FAILURE);
+    }
+    scan_generate(numbers, L, H, (unsigned int)time(NULL));
+    if (scan_write_file("input.txt", numbers, L) == -1) {
+        perror("Error writing input.txt");
+        exit(EXIT_FAILURE);
+    }
+    free(numbers);
 
     int fd_clear = open("output-DFSp2.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (fd_clear == -1) {
@@ -42,7 +50,11 @@ int main(int argc, char* argv[]) {
     close(fd_clear);
 
     int size;
-    int *data = read_data("input.txt", &size);
+    int *data = scan_read_file("input.txt", &size);
+    if (!data) {
+        perror("Error reading input.txt");
+        exit(EXIT_FAILURE);
+    }
     int segment_size = size / PN;
     pid_t pids[PN];
 
@@ -111,20 +123,19 @@ void sigint_handler(int signum) {
     sigint_received = 1;
 }
 
-void process_data_segment(int *data, int start, int end, int child_idx, int read_pipe, int write_pipe) {
+void process_data_segment(const int *data, int start, int end, int child_idx, int read_pipe, int write_pipe) {
     signal(SIGTSTP, pause_child);
     signal(SIGINT, sigint_handler); // Register SIGINT handler
 
-    int max = data[start];
-    int sum = 0, count_hidden = 0;
-    for (int i = start; i < end; ++i) {
-        if (data[i] > max) max = data[i];
-        if (data[i] >= MIN_NEGATIVE_INT && data[i] <= -1) {
-            count_hidden++;
-        }
-        sum += data[i];
+    struct scan_result result;
+    scan_result_init(&result);
+    if (scan_segment(data, start, end, &result) == -1) {
+        perror("scan_segment");
+        exit(EXIT_FAILURE);
     }
-    float avg = (end > start) ? (float)sum / (end - start) : 0.0;
+    int max = result.max;
+    int count_hidden = result.count_hidden;
+    float avg = (float)result.avg;
 
     // Write data to the output file
     int fd = open("output-DFSp2.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
@@ -134,13 +145,13 @@ void process_data_segment(int *data, int start, int end, int child_idx, int read
     }
 
     dprintf(fd, "Hi I'm process %d with return arg %d and my parent is %d.\n", getpid(), max, getppid());
-    for (int i = start; i < end; ++i) {
-        if (data[i] >= MIN_NEGATIVE_INT && data[i] <= -1) {
-            dprintf(fd, "I found the hidden key %d in position A[%d].\n", data[i], i);
-        }
+    for (int k = 0; k < result.count_hidden; ++k) {
+        int i = result.key_positions[k];
+        dprintf(fd, "I found the hidden key %d in position A[%d].\n", data[i], i);
     }
     dprintf(fd, "Max=%d, Avg=%.2f\n", max, avg);
     close(fd);
+    scan_result_free(&result);
 
     // Write count_hidden to the parent
     write(write_pipe, &count_hidden, sizeof(int));
@@ -184,61 +195,3 @@ void pause_child() {
 void handle_sigcont(int signum) {
     // No action needed, just resume
 }
-
-int *read_data(const char *filename, int *size) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
-
-    fscanf(file, "%d", size);
-    int *data = malloc((*size) * sizeof(int));
-    if (!data) {
-        perror("Malloc failed");
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < *size; ++i) {
-        if (fscanf(file, "%d", &data[i]) != 1) {
-            perror("Failed to read integer from file");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    fclose(file);
-    return data;
-}
-
-void generate_and_hide_keys(const char* filename, int L, int H) {
-    FILE* file = fopen(filename, "w");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
-
-    srand((unsigned int)time(NULL));
-    fprintf(file, "%d\n", L);
-    int* numbers = malloc(L * sizeof(int));
-    if (!numbers) {
-        perror("Failed to allocate memory for numbers array");
-        fclose(file);
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < L; ++i) {
-        numbers[i] = rand() % MAX_POSITIVE_INT + 1;
-    }
-
-    for (int i = 0; i < H; ++i) {
-        int pos = rand() % L;
-        numbers[pos] = MIN_NEGATIVE_INT + rand() % (1 - MIN_NEGATIVE_INT);
-    }
-
-    for (int i = 0; i < L; ++i) {
-        fprintf(file, "%d\n", numbers[i]);
-    }
-
-    free(numbers);
-    fclose(file);
-}
\ No newline at end of file
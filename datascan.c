@@ -0,0 +1,280 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#include "datascan.h"
+#include "scan_progress.h"
+
+#define HASH_MULTIPLIER 0x9e3779b97f4a7c15ull
+#define HASH_LANES 4
+
+int *scan_read_file(const char *filename, int *size) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        return NULL;
+    }
+
+    if (fscanf(file, "%d", size) != 1 || *size < 0) {
+        fclose(file);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int *data = malloc((*size > 0 ? *size : 1) * sizeof(int));
+    if (!data) {
+        fclose(file);
+        return NULL;
+    }
+
+    for (int i = 0; i < *size; ++i) {
+        if (fscanf(file, "%d", &data[i]) != 1) {
+            free(data);
+            fclose(file);
+            errno = EINVAL;
+            return NULL;
+        }
+    }
+
+    fclose(file);
+    return data;
+}
+
+int scan_write_file(const char *filename, const int *data, int size) {
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        return -1;
+    }
+
+    fprintf(file, "%d\n", size);
+    for (int i = 0; i < size; ++i) {
+        fprintf(file, "%d\n", data[i]);
+    }
+
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+void scan_generate(int *data, int size, int hidden, unsigned int seed) {
+    srand(seed);
+
+    for (int i = 0; i < size; ++i) {
+        data[i] = rand() % MAX_POSITIVE_INT + 1;
+    }
+
+    for (int i = 0; i < hidden && size > 0; ++i) {
+        int pos = rand() % size;
+        data[pos] = MIN_NEGATIVE_INT + rand() % (1 - MIN_NEGATIVE_INT);
+    }
+}
+
+void scan_segment_bounds(int size, int num_segments, int idx, int *start, int *end) {
+    int base_segment_size = size / num_segments;
+    int remaining_elements = size % num_segments;
+
+    *start = idx * base_segment_size + (idx < remaining_elements ? idx : remaining_elements);
+    *end = *start + base_segment_size + (idx < remaining_elements ? 1 : 0);
+    if (*start > size) *start = size;
+    if (*end > size) *end = size;
+}
+
+void scan_result_init(struct scan_result *result) {
+    memset(result, 0, sizeof(*result));
+    result->max = INT_MIN;
+}
+
+void scan_result_free(struct scan_result *result) {
+    free(result->key_positions);
+    scan_result_init(result);
+}
+
+int scan_result_reserve(struct scan_result *result, int needed) {
+    if (needed <= result->key_capacity) {
+        return 0;
+    }
+
+    int capacity = result->key_capacity ? result->key_capacity : 16;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+
+    int *positions = realloc(result->key_positions, capacity * sizeof(int));
+    if (!positions) {
+        return -1;
+    }
+    result->key_positions = positions;
+    result->key_capacity = capacity;
+    return 0;
+}
+
+int scan_segment(const int *data, int start, int end, struct scan_result *result) {
+    return scan_segment_progress(data, start, end, result, NULL);
+}
+
+int scan_segment_progress(const int *data, int start, int end, struct scan_result *result,
+                          struct scan_progress_worker *worker) {
+    int max = INT_MIN;
+    int64_t sum = 0;
+    int count_hidden = 0;
+
+    // Without a worker to report to, the whole range is a single chunk.
+    int chunk = worker ? SCAN_PROGRESS_CHUNK : (end > start ? end - start : 1);
+    for (int chunk_start = start; chunk_start < end; chunk_start += chunk) {
+        int chunk_end = end - chunk_start > chunk ? chunk_start + chunk : end;
+        for (int i = chunk_start; i < chunk_end; ++i) {
+            if (data[i] > max) {
+                max = data[i];
+            }
+            if (SCAN_IS_HIDDEN_KEY(data[i])) {
+                if (scan_result_reserve(result, count_hidden + 1) == -1) {
+                    return -1;
+                }
+                result->key_positions[count_hidden++] = i;
+            }
+            sum += data[i];
+        }
+        scan_progress_update(worker, chunk_end - start, count_hidden);
+    }
+
+    result->count = end > start ? end - start : 0;
+    result->max = max;
+    result->sum = sum;
+    result->avg = result->count ? (double)sum / result->count : 0.0;
+    result->count_hidden = count_hidden;
+    return 0;
+}
+
+int scan_result_valid(const struct scan_result *result, int start, int end) {
+    if (result->count_hidden < 0 || result->count_hidden > result->count) {
+        return 0;
+    }
+    for (int k = 0; k < result->count_hidden; ++k) {
+        int pos = result->key_positions[k];
+        if (pos < start || pos >= end || (k > 0 && pos <= result->key_positions[k - 1])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int scan_result_merge(struct scan_result *dst, const struct scan_result *src) {
+    if (scan_result_reserve(dst, dst->count_hidden + src->count_hidden) == -1) {
+        return -1;
+    }
+    memcpy(dst->key_positions + dst->count_hidden, src->key_positions, src->count_hidden * sizeof(int));
+
+    if (src->max > dst->max) {
+        dst->max = src->max;
+    }
+    dst->count += src->count;
+    dst->sum += src->sum;
+    dst->count_hidden += src->count_hidden;
+    dst->avg = dst->count ? (double)dst->sum / dst->count : 0.0;
+    return 0;
+}
+
+int scan_data(const int *data, int size, int num_segments, struct scan_result *result) {
+    if (num_segments < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct scan_result segment;
+    scan_result_init(&segment);
+    scan_result_free(result);
+
+    for (int idx = 0; idx < num_segments; ++idx) {
+        int start, end;
+        scan_segment_bounds(size, num_segments, idx, &start, &end);
+        if (scan_segment(data, start, end, &segment) == -1 || scan_result_merge(result, &segment) == -1) {
+            scan_result_free(&segment);
+            return -1;
+        }
+    }
+
+    scan_result_free(&segment);
+    return 0;
+}
+
+static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+uint64_t scan_hash_bytes(const void *buf, size_t len, uint64_t seed) {
+    const unsigned char *p = buf;
+    uint64_t lanes[HASH_LANES] = {seed + 1, seed + 2, seed + 3, seed + 4};
+    uint64_t h = seed ^ (len * HASH_MULTIPLIER);
+
+    for (; len >= HASH_LANES * 8; p += HASH_LANES * 8, len -= HASH_LANES * 8) {
+        for (int l = 0; l < HASH_LANES; ++l) {
+            uint64_t word;
+            memcpy(&word, p + l * 8, 8);
+            lanes[l] = (lanes[l] ^ word) * HASH_MULTIPLIER;
+            lanes[l] ^= lanes[l] >> 29;
+        }
+    }
+    for (int l = 0; l < HASH_LANES; ++l) {
+        h = (h ^ mix(lanes[l])) * HASH_MULTIPLIER;
+    }
+
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        h = (h ^ word) * HASH_MULTIPLIER;
+        h ^= h >> 29;
+    }
+    if (len > 0) {
+        uint64_t word = 0;
+        memcpy(&word, p, len);
+        h = (h ^ word) * HASH_MULTIPLIER;
+    }
+    return mix(h);
+}
+
+int scan_read_all(int fd, void *buf, size_t len) {
+    char *p = buf;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            if (n == 0) {
+                errno = ECONNRESET;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+int scan_write_all(int fd, const void *buf, size_t len) {
+    const char *p = buf;
+    int is_socket = 1;
+    while (len > 0) {
+        // send() only to suppress SIGPIPE; pipes fall back to write().
+        ssize_t n = is_socket ? send(fd, p, len, MSG_NOSIGNAL) : write(fd, p, len);
+        if (n == -1) {
+            if (errno == ENOTSOCK && is_socket) {
+                is_socket = 0;
+                continue;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
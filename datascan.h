@@ -0,0 +1,89 @@
+#ifndef DATASCAN_H
+#define DATASCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_POSITIVE_INT 10000
+#define MIN_NEGATIVE_INT -60
+#define HIDDEN_KEY_LOWER_BOUND -60
+#define HIDDEN_KEY_UPPER_BOUND -1
+
+#define SCAN_IS_HIDDEN_KEY(v) ((v) >= HIDDEN_KEY_LOWER_BOUND && (v) <= HIDDEN_KEY_UPPER_BOUND)
+
+// Result of scanning a range of the data. The key_positions array is owned
+// by the result and released with scan_result_free().
+struct scan_result {
+    int count;              // number of elements scanned
+    int max;
+    int64_t sum;
+    double avg;
+    int count_hidden;
+    int *key_positions;     // ascending indices of hidden keys in the input
+    int key_capacity;
+};
+
+// Reads "<size>\n<v0>\n<v1>..." from filename. Returns a malloc'd array or
+// NULL with errno set on failure.
+int *scan_read_file(const char *filename, int *size);
+
+// Writes data in the same format scan_read_file() reads. Returns 0 or -1.
+int scan_write_file(const char *filename, const int *data, int size);
+
+// Fills data with random values in [1, MAX_POSITIVE_INT] and hides H keys
+// drawn from [MIN_NEGATIVE_INT, -1] at random positions.
+void scan_generate(int *data, int size, int hidden, unsigned int seed);
+
+// Balanced partition used by the BFS tree: the first size % num_segments
+// segments receive one extra element.
+void scan_segment_bounds(int size, int num_segments, int idx, int *start, int *end);
+
+// Scans data[start, end) into result, replacing its previous contents.
+// Returns 0 or -1 with errno set.
+int scan_segment(const int *data, int start, int end, struct scan_result *result);
+
+// Same as scan_segment(), publishing elements scanned and keys found to
+// worker every SCAN_PROGRESS_CHUNK elements. worker may be NULL.
+struct scan_progress_worker;
+int scan_segment_progress(const int *data, int start, int end, struct scan_result *result,
+                          struct scan_progress_worker *worker);
+
+// Checks a result read back from a file or another process: 0 <= count_hidden
+// <= count, and key positions strictly ascending inside [start, end).
+// Returns 1 if it can be merged as the result of that range, 0 if not.
+int scan_result_valid(const struct scan_result *result, int start, int end);
+
+// Merges src into dst. Positions in src must all be greater than those in dst.
+int scan_result_merge(struct scan_result *dst, const struct scan_result *src);
+
+// Scans the whole buffer as num_segments balanced segments and merges them
+// into result. The buffer is only read, never copied.
+int scan_data(const int *data, int size, int num_segments, struct scan_result *result);
+
+// Fast non-cryptographic 64-bit hash used for checkpoints, cache keys and
+// input checks. Four independent lanes of 8-byte words keep several
+// multiplies in flight, so it runs at memory speed.
+uint64_t scan_hash_bytes(const void *buf, size_t len, uint64_t seed);
+
+// Read or write exactly len bytes on a pipe or socket, retrying on EINTR and
+// short transfers. A peer that closes early fails with ECONNRESET; writes
+// to sockets never raise SIGPIPE.
+int scan_read_all(int fd, void *buf, size_t len);
+int scan_write_all(int fd, const void *buf, size_t len);
+
+// Every result must be initialized before its first use.
+void scan_result_init(struct scan_result *result);
+void scan_result_free(struct scan_result *result);
+
+// Grows key_positions to hold at least needed entries. Returns 0 or -1.
+int scan_result_reserve(struct scan_result *result, int needed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -1,63 +1,90 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/wait.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <time.h>
+#include <sys/mman.h>
+
+#include "datascan.h"
+#include "scan_progress.h"
+#include "scan_cache.h"
 
-#define MAX_POSITIVE_INT 10000
-#define MIN_NEGATIVE_INT -60
 #define HIDDEN_KEYS_COUNT 60
 #define MAX_CHILDREN 4
 #define MAX_TREE_HEIGHT 3
-#define HIDDEN_KEY_LOWER_BOUND -60
-#define HIDDEN_KEY_UPPER_BOUND -1
-
-
-int *read_data(const char *filename, int *size) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
 
-    fscanf(file, "%d", size);
-    int *data = malloc((*size) * sizeof(int));
-    if (!data) {
-        perror("Malloc failed");
-        exit(EXIT_FAILURE);
+// Shared-memory progress counters, one slot per leaf segment (NULL if unavailable)
+static struct scan_progress *progress;
+
+// What each leaf found, left in a shared mapping for the root to merge into
+// the cache entry. Key positions of a leaf go to leaf_keys[start..]. Only
+// mapped when the result cache is on.
+struct leaf_result {
+    int32_t done;
+    int32_t count;
+    int32_t max;
+    int32_t count_hidden;
+    int64_t sum;
+};
+static struct leaf_result *leaf_results;
+static int *leaf_keys;
+
+static void publish_result(int leaf, int start, const struct scan_result *result) {
+    if (!leaf_results) {
+        return;
     }
+    memcpy(&leaf_keys[start], result->key_positions, result->count_hidden * sizeof(int));
+    leaf_results[leaf].count = result->count;
+    leaf_results[leaf].max = result->max;
+    leaf_results[leaf].sum = result->sum;
+    leaf_results[leaf].count_hidden = result->count_hidden;
+    leaf_results[leaf].done = 1;
+}
 
-    for (int i = 0; i < *size; ++i) {
-        if (fscanf(file, "%d", &data[i]) != 1) {
-            perror("Failed to read integer from file");
-            exit(EXIT_FAILURE);
+// Merges the leaves' results in segment order. Fails if a leaf did not finish.
+static int collect_results(int size, int leaves, struct scan_result *result) {
+    scan_result_free(result);
+    for (int leaf = 0; leaf < leaves; ++leaf) {
+        int start, end;
+        scan_segment_bounds(size, leaves, leaf, &start, &end);
+        if (start >= size) {
+            continue;
+        }
+        if (!leaf_results[leaf].done) {
+            return -1;
+        }
+        struct scan_result part = {
+            .count = leaf_results[leaf].count,
+            .max = leaf_results[leaf].max,
+            .sum = leaf_results[leaf].sum,
+            .count_hidden = leaf_results[leaf].count_hidden,
+            .key_positions = &leaf_keys[start],
+        };
+        if (scan_result_merge(result, &part) == -1) {
+            return -1;
         }
     }
-
-    fclose(file);
-    return data;
+    return 0;
 }
-#include <time.h>
 
-void process_data_segment(int *data, int start, int end, int process_id, int write_pipe) {
+void process_data_segment(const int *data, int start, int end, int process_id, int leaf, int write_pipe, struct scan_progress_worker *worker) {
     printf("Child %d (PID: %d) started processing data segment from %d to %d.\n", process_id, getpid(), start, end); // Log when child starts
 
     clock_t begin = clock(); // Start the clock to measure processing time
+    scan_progress_begin(worker, end - start);
 
-    int max = data[start];
-    int sum = 0, count_hidden = 0;
-    for (int i = start; i < end; ++i) {
-        if (data[i] > max) {
-            max = data[i];
-        }
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            count_hidden++;
-        }
-        sum += data[i];
+    struct scan_result result;
+    scan_result_init(&result);
+    if (scan_segment_progress(data, start, end, &result, worker) == -1) {
+        perror("scan_segment");
+        exit(EXIT_FAILURE);
     }
-    float avg = (end > start) ? (float)sum / (end - start) : 0.0;
+    publish_result(leaf, start, &result);
+    int max = result.max;
+    float avg = (float)result.avg;
 
     clock_t end_clock = clock(); // End the clock
 
@@ -65,13 +92,13 @@ void process_data_segment(int *data, int start, int end, int process_id, int wri
     double time_spent = (double)(end_clock - begin) / CLOCKS_PER_SEC;
 
 
-    for (int i = start; i < end; ++i) {
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            // Write to pipe when a key is found
-            write(write_pipe, &data[i], sizeof(int));
-        }
+    scan_progress_set_phase(worker, SCAN_PHASE_KEYS);
+    for (int k = 0; k < result.count_hidden; ++k) {
+        // Write to pipe when a key is found
+        write(write_pipe, &data[result.key_positions[k]], sizeof(int));
     }
 
+    scan_progress_set_phase(worker, SCAN_PHASE_REPORT);
     int fd = open("output-BFS.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
     if (fd == -1) {
         perror("Error opening file");
@@ -80,10 +107,9 @@ void process_data_segment(int *data, int start, int end, int process_id, int wri
 
     // Writing process data and findings to the file
     dprintf(fd, "Hi I'm process %d with return arg %d and my parent is %d.\n", process_id, max, getppid());
-    for (int i = start; i < end; ++i) {
-        if (data[i] >= HIDDEN_KEY_LOWER_BOUND && data[i] <= HIDDEN_KEY_UPPER_BOUND) {
-            dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
-        }
+    for (int k = 0; k < result.count_hidden; ++k) {
+        int i = result.key_positions[k];
+        dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
     }
     dprintf(fd, "Max=%d, Avg=%.2f\n", max, avg);
 
@@ -93,20 +119,19 @@ void process_data_segment(int *data, int start, int end, int process_id, int wri
 
     close(fd);
     close(write_pipe); // Close the write end of the pipe
+    scan_result_free(&result);
+    scan_progress_finish(worker);
 
 }
 
-void bfs_process_data(int *data, int size, int current_level, int max_levels, int idx_in_level, int write_pipe) {
+void bfs_process_data(const int *data, int size, int current_level, int max_levels, int idx_in_level, int write_pipe) {
     int num_processes_at_max_level = 1 << max_levels; // Total number of processes at the max level
-    int base_segment_size = size / num_processes_at_max_level;
-    int remaining_elements = size % num_processes_at_max_level;
-
-    int start = idx_in_level * base_segment_size + (idx_in_level < remaining_elements ? idx_in_level : remaining_elements);
-    int end = start + base_segment_size + (idx_in_level < remaining_elements ? 1 : 0);
+    int start, end;
+    scan_segment_bounds(size, num_processes_at_max_level, idx_in_level, &start, &end);
 
     if (current_level == max_levels) {
         if (start < size) { // Ensure the process has data to process
-            process_data_segment(data, start, end, getpid(), write_pipe);
+            process_data_segment(data, start, end, getpid(), idx_in_level, write_pipe, scan_progress_worker(progress, idx_in_level));
         }
         return;
     }
@@ -158,8 +183,63 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // H and PN do not change the run and L only decides the Success line,
+    // which is recomputed from the cached key count, so the input alone
+    // identifies the result.
+    struct scan_cache cache;
+    struct scan_cache_key cache_key;
+    if (scan_cache_from_env(&cache) == -1 ||
+        (cache.mode != SCAN_CACHE_OFF && scan_cache_key(&cache, "input.txt", "project1BFS", NULL, 0, &cache_key) == -1)) {
+        perror("Warning: result cache disabled");
+        cache.mode = SCAN_CACHE_OFF;
+    }
+
+    struct scan_result cached;
+    char *report;
+    size_t report_len;
+    scan_result_init(&cached);
+    if (scan_cache_get(&cache, &cache_key, &cached, &report, &report_len) == 1) {
+        int fd = open("output-BFS.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            perror("Error opening output file");
+            exit(EXIT_FAILURE);
+        }
+        write(fd, report, report_len);
+        close(fd);
+        if (cached.count_hidden >= L) {
+            printf("Success: Found %d keys.\n", L);
+        }
+        free(report);
+        scan_result_free(&cached);
+        return 0;
+    }
+
     int size;
-    int *data = read_data("input.txt", &size);
+    int *data = scan_read_file("input.txt", &size);
+    if (!data) {
+        perror("Error reading input.txt");
+        exit(EXIT_FAILURE);
+    }
+
+    progress = scan_progress_create(scan_progress_name(), 1 << MAX_TREE_HEIGHT);
+    if (!progress) {
+        perror("Warning: progress counters unavailable");
+    } else {
+        scan_progress_unlink_on_signal(scan_progress_name());
+        fprintf(stderr, "Progress counters: scanmon -n %s\n", scan_progress_name());
+    }
+
+    // Pages of leaf_keys are only touched where keys are found.
+    int leaves = 1 << MAX_TREE_HEIGHT;
+    if (cache.mode != SCAN_CACHE_OFF) {
+        leaf_results = mmap(NULL, leaves * sizeof(*leaf_results), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        leaf_keys = mmap(NULL, (size > 0 ? size : 1) * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (leaf_results == MAP_FAILED || leaf_keys == MAP_FAILED) {
+            perror("Warning: result cache disabled");
+            cache.mode = SCAN_CACHE_OFF;
+            leaf_results = NULL;
+        }
+    }
 
     int pipefd[2];
     if (pipe(pipefd) == -1) {
@@ -185,5 +265,16 @@ int main(int argc, char *argv[]) {
 
     // Close the read end of the pipe
     close(pipefd[0]);
+    if (progress) {
+        scan_progress_destroy(progress, scan_progress_name());
+    }
+
+    if (cache.mode != SCAN_CACHE_OFF) {
+        if (collect_results(size, leaves, &cached) == -1 ||
+            scan_cache_put_file(&cache, &cache_key, &cached, "output-BFS.txt") == -1) {
+            perror("Warning: could not store result in cache");
+        }
+        scan_result_free(&cached);
+    }
     return 0;
 }
\ No newline at end of file
@@ -6,12 +6,10 @@
 #include <fcntl.h>
 #include <time.h>
 
-#define MAX_POSITIVE_INT 10000
-#define MIN_NEGATIVE_INT -60
+#include "datascan.h"
+#include "scan_progress.h"
 
-int *read_data(const char *filename, int *size);
-void process_data_segment(int *data, int start, int end, int child_idx);
-void generate_and_hide_keys(const char* filename, int L, int H);
+void process_data_segment(const int *data, int start, int end, int child_idx, struct scan_progress_worker *worker);
 
 int main(int argc, char* argv[]) {
     if (argc != 4) {
@@ -28,7 +26,17 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
-    generate_and_hide_keys("input.txt", L, H);
+    int *numbers = malloc(L * sizeof(int));
+    if (!numbers) {
+        perror("Failed to allocate memory for numbers array");
+        exit(EXIT_FAILURE);
+    }
+    scan_generate(numbers, L, H, (unsigned int)time(NULL));
+    if (scan_write_file("input.txt", numbers, L) == -1) {
+        perror("Error writing input.txt");
+        exit(EXIT_FAILURE);
+    }
+    free(numbers);
 
     int fd_clear = open("output-DFS.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
     if (fd_clear == -1) {
@@ -37,10 +45,24 @@ int main(int argc, char* argv[]) {
     }
     close(fd_clear);
     int size;
-    int *data = read_data("input.txt", &size);
+    int *data = scan_read_file("input.txt", &size);
+    if (!data) {
+        perror("Error reading input.txt");
+        exit(EXIT_FAILURE);
+    }
     int segment_size = size / PN;
     pid_t pids[PN];
 
+    // Workers beyond SCAN_PROGRESS_MAX_WORKERS run without progress counters
+    int num_slots = PN < SCAN_PROGRESS_MAX_WORKERS ? PN : SCAN_PROGRESS_MAX_WORKERS;
+    struct scan_progress *progress = scan_progress_create(scan_progress_name(), num_slots);
+    if (!progress) {
+        perror("Warning: progress counters unavailable");
+    } else {
+        scan_progress_unlink_on_signal(scan_progress_name());
+        fprintf(stderr, "Progress counters: scanmon -n %s\n", scan_progress_name());
+    }
+
     for (int i = 0; i < PN; ++i) {
         pids[i] = fork();
         if (pids[i] < 0) {
@@ -51,7 +73,7 @@ int main(int argc, char* argv[]) {
         if (pids[i] == 0) { // Child process
             int start = i * segment_size;
             int end = (i == PN - 1) ? size : (i + 1) * segment_size;
-            process_data_segment(data, start, end, i);
+            process_data_segment(data, start, end, i, scan_progress_worker(progress, i));
             exit(EXIT_SUCCESS);
         }
     }
@@ -61,11 +83,14 @@ int main(int argc, char* argv[]) {
         waitpid(pids[i], NULL, 0);
     }
 
+    if (progress) {
+        scan_progress_destroy(progress, scan_progress_name());
+    }
     free(data);
     return 0;
 }
 
-void process_data_segment(int *data, int start, int end, int child_idx) {
+void process_data_segment(const int *data, int start, int end, int child_idx, struct scan_progress_worker *worker) {
     int fd = open("output-DFS.txt", O_WRONLY | O_CREAT | O_APPEND, 0644);
     if (fd == -1) {
         perror("Error opening output file");
@@ -73,79 +98,29 @@ void process_data_segment(int *data, int start, int end, int child_idx) {
     }
 
     clock_t begin = clock();
-    int max = data[start];
-    int sum = 0;
-    for (int i = start; i < end; ++i) {
-        if (data[i] > max) max = data[i];
-        if (data[i] >= MIN_NEGATIVE_INT && data[i] <= -1) {
-            dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
-        }
-        sum += data[i];
+    scan_progress_begin(worker, end - start);
+    struct scan_result result;
+    scan_result_init(&result);
+    if (scan_segment_progress(data, start, end, &result, worker) == -1) {
+        perror("scan_segment");
+        exit(EXIT_FAILURE);
     }
-    float avg = (end > start) ? (float)sum / (end - start) : 0.0;
+    scan_progress_set_phase(worker, SCAN_PHASE_KEYS);
+    for (int k = 0; k < result.count_hidden; ++k) {
+        int i = result.key_positions[k];
+        dprintf(fd, "I am process %d and I found the hidden key %d in position A[%d].\n", getpid(), data[i], i);
+    }
+    int max = result.max;
+    float avg = (float)result.avg;
     clock_t end_clock = clock();
     double time_spent = (double)(end_clock - begin) / CLOCKS_PER_SEC;
 
+    scan_progress_set_phase(worker, SCAN_PHASE_REPORT);
     dprintf(fd, "Hi I'm process %d with return arg %d and my parent is %d.\nMax=%d, Avg=%.2f\nProcess %d time taken: %f seconds\n", 
             getpid(), max, getppid(), max, avg, getpid(), time_spent);
 
     close(fd);
+    scan_result_free(&result);
+    scan_progress_finish(worker);
 }
 
-int *read_data(const char *filename, int *size) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
-
-    fscanf(file, "%d", size);
-    int *data = malloc((*size) * sizeof(int));
-    if (!data) {
-        perror("Malloc failed");
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < *size; ++i) {
-        if (fscanf(file, "%d", &data[i]) != 1) {
-            perror("Failed to read integer from file");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    fclose(file);
-    return data;
-}
-
-void generate_and_hide_keys(const char* filename, int L, int H) {
-    FILE* file = fopen(filename, "w");
-    if (!file) {
-        perror("Error opening file");
-        exit(EXIT_FAILURE);
-    }
-
-    srand((unsigned int)time(NULL));
-    fprintf(file, "%d\n", L);
-    int* numbers = malloc(L * sizeof(int));
-    if (!numbers) {
-        perror("Failed to allocate memory for numbers array");
-        fclose(file);
-        exit(EXIT_FAILURE);
-    }
-
-    for (int i = 0; i < L; ++i) {
-        numbers[i] = rand() % MAX_POSITIVE_INT + 1;
-    }
-
-    for (int i = 0; i < H; ++i) {
-        int pos = rand() % L;
-        numbers[pos] = MIN_NEGATIVE_INT + rand() % (1 - MIN_NEGATIVE_INT);
-    }
-
-    for (int i = 0; i < L; ++i) {
-        fprintf(file, "%d\n", numbers[i]);
-    }
-
-    free(numbers);
-    fclose(file);
-}
@@ -0,0 +1,408 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "scan_cache.h"
+
+#define CACHE_ENTRY_MAGIC 0x31435343u /* "CSC1" */
+#define CACHE_META_MAGIC 0x314d5343u /* "CSM1" */
+#define CACHE_ENTRY_SUFFIX ".entry"
+#define CACHE_META_SUFFIX ".meta"
+#define READ_CHUNK (1 << 20)
+
+struct cache_entry_header {
+    uint32_t magic;
+    int32_t num_params;
+    uint64_t id;
+    int64_t input_bytes;
+    char tag[16];
+    int32_t params[SCAN_CACHE_MAX_PARAMS];
+    int64_t sum;
+    int64_t report_len;
+    int32_t count;
+    int32_t max;
+    int32_t count_hidden;
+    int32_t reserved;
+};
+
+struct cache_meta {
+    uint32_t magic;
+    uint32_t reserved;
+    int64_t input_bytes;
+    uint64_t content;
+};
+
+struct cache_file {
+    char name[NAME_MAX + 1];
+    off_t size;
+    struct timespec mtime;
+};
+
+int scan_cache_from_env(struct scan_cache *cache) {
+    const char *mode = getenv(SCAN_CACHE_ENV);
+    const char *dir = getenv(SCAN_CACHE_DIR_ENV);
+    const char *max_bytes = getenv(SCAN_CACHE_MAX_BYTES_ENV);
+
+    memset(cache, 0, sizeof(*cache));
+    if (!mode || !*mode || strcmp(mode, "off") == 0 || strcmp(mode, "0") == 0) {
+        cache->mode = SCAN_CACHE_OFF;
+        return 0;
+    } else if (strcmp(mode, "meta") == 0) {
+        cache->mode = SCAN_CACHE_METADATA;
+    } else if (strcmp(mode, "content") == 0 || strcmp(mode, "1") == 0) {
+        cache->mode = SCAN_CACHE_CONTENT;
+    } else {
+        errno = EINVAL;
+        return -1;
+    }
+
+    snprintf(cache->dir, sizeof(cache->dir), "%s", dir && *dir ? dir : SCAN_CACHE_DEFAULT_DIR);
+    cache->max_bytes = max_bytes && *max_bytes ? atoll(max_bytes) : SCAN_CACHE_DEFAULT_MAX_BYTES;
+    if (mkdir(cache->dir, 0755) == -1 && errno != EEXIST) {
+        return -1;
+    }
+    return 0;
+}
+
+static void cache_path(const struct scan_cache *cache, uint64_t hash, const char *suffix, char *path, size_t len) {
+    snprintf(path, len, "%s/%016llx%s", cache->dir, (unsigned long long)hash, suffix);
+}
+
+int scan_hash_file(const char *input, uint64_t *content) {
+    int fd = open(input, O_RDONLY);
+    if (fd == -1) {
+        return -1;
+    }
+
+    char *buf = malloc(READ_CHUNK);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+
+    // Chunk hashes are chained, so every chunk but the last is filled
+    // completely to keep the result independent of short reads.
+    uint64_t h = 0;
+    ssize_t n = 0;
+    for (;;) {
+        size_t filled = 0;
+        while (filled < READ_CHUNK && (n = read(fd, buf + filled, READ_CHUNK - filled)) > 0) {
+            filled += n;
+        }
+        if (n == -1 && errno == EINTR) {
+            continue;
+        }
+        if (filled > 0) {
+            h = scan_hash_bytes(buf, filled, h);
+        }
+        if (n <= 0) {
+            break;
+        }
+    }
+
+    free(buf);
+    close(fd);
+    if (n == -1) {
+        return -1;
+    }
+    *content = h;
+    return 0;
+}
+
+// Writes header, body and tail to path through a temporary file so readers
+// never see a torn entry.
+static int write_file(const char *path, const void *header, size_t header_len, const void *body, size_t body_len,
+                      const void *tail, size_t tail_len) {
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, getpid());
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        return -1;
+    }
+    int ok = fwrite(header, 1, header_len, file) == header_len &&
+             (body_len == 0 || fwrite(body, 1, body_len, file) == body_len) &&
+             (tail_len == 0 || fwrite(tail, 1, tail_len, file) == tail_len);
+    if (fclose(file) != 0 || !ok) {
+        remove(tmp_path);
+        return -1;
+    }
+    return rename(tmp_path, path);
+}
+
+static int write_meta(const struct scan_cache *cache, const struct scan_cache_key *key) {
+    struct cache_meta meta = {
+        .magic = CACHE_META_MAGIC,
+        .input_bytes = key->input_bytes,
+        .content = key->content,
+    };
+    char path[4200];
+    cache_path(cache, key->meta, CACHE_META_SUFFIX, path, sizeof(path));
+    return write_file(path, &meta, sizeof(meta), NULL, 0, NULL, 0);
+}
+
+int scan_cache_key(const struct scan_cache *cache, const char *input, const char *tag,
+                   const int *params, int num_params, struct scan_cache_key *key) {
+    if (num_params < 0 || num_params > SCAN_CACHE_MAX_PARAMS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stat st;
+    char real[PATH_MAX];
+    if (stat(input, &st) == -1 || !realpath(input, real)) {
+        return -1;
+    }
+
+    memset(key, 0, sizeof(*key));
+    snprintf(key->tag, sizeof(key->tag), "%s", tag);
+    key->num_params = num_params;
+    memcpy(key->params, params, num_params * sizeof(int));
+    key->input_bytes = st.st_size;
+
+    int64_t stamp[5] = {st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec, (int64_t)st.st_ino, (int64_t)st.st_dev};
+    key->meta = scan_hash_bytes(stamp, sizeof(stamp), scan_hash_bytes(real, strlen(real), 0));
+
+    int have_content = 0;
+    if (cache->mode == SCAN_CACHE_METADATA) {
+        char path[4200];
+        struct cache_meta meta;
+        cache_path(cache, key->meta, CACHE_META_SUFFIX, path, sizeof(path));
+
+        FILE *file = fopen(path, "rb");
+        if (file) {
+            have_content = fread(&meta, sizeof(meta), 1, file) == 1 && meta.magic == CACHE_META_MAGIC &&
+                           meta.input_bytes == st.st_size;
+            fclose(file);
+        }
+        if (have_content) {
+            key->content = meta.content;
+        }
+    }
+    if (!have_content && scan_hash_file(input, &key->content) == -1) {
+        return -1;
+    }
+
+    // Params are hashed as given after parsing, so "08" and "8" share an entry.
+    uint64_t seed = key->content ^ scan_hash_bytes(key->tag, sizeof(key->tag), 0);
+    key->id = scan_hash_bytes(key->params, sizeof(key->params), seed) ^ (uint64_t)num_params;
+    return 0;
+}
+
+int scan_cache_get(const struct scan_cache *cache, const struct scan_cache_key *key,
+                   struct scan_result *result, char **report, size_t *report_len) {
+    if (cache->mode == SCAN_CACHE_OFF) {
+        return 0;
+    }
+
+    char path[4200];
+    cache_path(cache, key->id, CACHE_ENTRY_SUFFIX, path, sizeof(path));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return errno == ENOENT ? 0 : -1;
+    }
+
+    struct cache_entry_header header;
+    struct stat st;
+    // Anything that does not describe exactly this query is treated as a miss,
+    // including lengths the file is too short to hold.
+    if (fstat(fileno(file), &st) == -1 || fread(&header, sizeof(header), 1, file) != 1 ||
+        header.magic != CACHE_ENTRY_MAGIC || header.id != key->id ||
+        header.input_bytes != key->input_bytes || strncmp(header.tag, key->tag, sizeof(header.tag)) != 0 ||
+        header.num_params != key->num_params ||
+        memcmp(header.params, key->params, key->num_params * sizeof(int)) != 0 ||
+        header.count_hidden < 0 || header.count_hidden > header.count || header.report_len < 0 ||
+        (int64_t)header.count_hidden * (int64_t)sizeof(int) + header.report_len >
+            (int64_t)(st.st_size - sizeof(header))) {
+        fclose(file);
+        return 0;
+    }
+
+    char *text = malloc(header.report_len + 1);
+    if (!text || scan_result_reserve(result, header.count_hidden) == -1) {
+        free(text);
+        fclose(file);
+        return -1;
+    }
+    if ((int)fread(result->key_positions, sizeof(int), header.count_hidden, file) != header.count_hidden ||
+        (int64_t)fread(text, 1, header.report_len, file) != header.report_len) {
+        free(text);
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    text[header.report_len] = '\0';
+
+    result->count = header.count;
+    result->max = header.max;
+    result->sum = header.sum;
+    result->avg = header.count ? (double)header.sum / header.count : 0.0;
+    result->count_hidden = header.count_hidden;
+    if (!scan_result_valid(result, 0, header.count)) {
+        free(text);
+        return 0;
+    }
+    if (report) {
+        *report = text;
+    } else {
+        free(text);
+    }
+    if (report_len) {
+        *report_len = header.report_len;
+    }
+
+    // Bump the entry (and its metadata mapping) to most recently used. A hit
+    // found by hashing the content records the mapping for the next lookup.
+    utimensat(AT_FDCWD, path, NULL, 0);
+    if (cache->mode == SCAN_CACHE_METADATA) {
+        cache_path(cache, key->meta, CACHE_META_SUFFIX, path, sizeof(path));
+        if (utimensat(AT_FDCWD, path, NULL, 0) == -1 && errno == ENOENT) {
+            write_meta(cache, key);
+        }
+    }
+    return 1;
+}
+
+static int compare_mtime(const void *a, const void *b) {
+    const struct cache_file *fa = a, *fb = b;
+    if (fa->mtime.tv_sec != fb->mtime.tv_sec) {
+        return fa->mtime.tv_sec < fb->mtime.tv_sec ? -1 : 1;
+    }
+    return fa->mtime.tv_nsec < fb->mtime.tv_nsec ? -1 : fa->mtime.tv_nsec > fb->mtime.tv_nsec;
+}
+
+static int has_suffix(const char *name, const char *suffix) {
+    size_t n = strlen(name), m = strlen(suffix);
+    return n > m && strcmp(name + n - m, suffix) == 0;
+}
+
+// Deletes least-recently-used files until the directory fits in max_bytes.
+static int evict(const struct scan_cache *cache) {
+    DIR *dir = opendir(cache->dir);
+    if (!dir) {
+        return -1;
+    }
+
+    struct cache_file *files = NULL;
+    int num_files = 0, capacity = 0;
+    int64_t total = 0;
+    struct dirent *ent;
+
+    while ((ent = readdir(dir))) {
+        if (!has_suffix(ent->d_name, CACHE_ENTRY_SUFFIX) && !has_suffix(ent->d_name, CACHE_META_SUFFIX)) {
+            continue;
+        }
+        char path[4200];
+        struct stat st;
+        snprintf(path, sizeof(path), "%s/%s", cache->dir, ent->d_name);
+        if (stat(path, &st) == -1) {
+            continue;
+        }
+
+        if (num_files == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            struct cache_file *grown = realloc(files, capacity * sizeof(*files));
+            if (!grown) {
+                free(files);
+                closedir(dir);
+                return -1;
+            }
+            files = grown;
+        }
+        snprintf(files[num_files].name, sizeof(files[num_files].name), "%s", ent->d_name);
+        files[num_files].size = st.st_size;
+        files[num_files].mtime = st.st_mtim;
+        num_files++;
+        total += st.st_size;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes) {
+        qsort(files, num_files, sizeof(*files), compare_mtime);
+        for (int i = 0; i < num_files && total > cache->max_bytes; ++i) {
+            char path[4200];
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, files[i].name);
+            if (unlink(path) == 0) {
+                total -= files[i].size;
+            }
+        }
+    }
+
+    free(files);
+    return 0;
+}
+
+int scan_cache_put(const struct scan_cache *cache, const struct scan_cache_key *key,
+                   const struct scan_result *result, const char *report, size_t report_len) {
+    if (cache->mode == SCAN_CACHE_OFF) {
+        return 0;
+    }
+
+    struct cache_entry_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CACHE_ENTRY_MAGIC;
+    header.num_params = key->num_params;
+    header.id = key->id;
+    header.input_bytes = key->input_bytes;
+    memcpy(header.tag, key->tag, sizeof(header.tag));
+    memcpy(header.params, key->params, sizeof(header.params));
+    header.sum = result->sum;
+    header.report_len = report_len;
+    header.count = result->count;
+    header.max = result->max;
+    header.count_hidden = result->count_hidden;
+
+    char path[4200];
+    cache_path(cache, key->id, CACHE_ENTRY_SUFFIX, path, sizeof(path));
+    if (write_file(path, &header, sizeof(header), result->key_positions, result->count_hidden * sizeof(int),
+                   report, report_len) == -1) {
+        return -1;
+    }
+
+    if (cache->mode == SCAN_CACHE_METADATA && write_meta(cache, key) == -1) {
+        return -1;
+    }
+
+    return evict(cache);
+}
+
+int scan_cache_put_file(const struct scan_cache *cache, const struct scan_cache_key *key,
+                        const struct scan_result *result, const char *report_path) {
+    if (cache->mode == SCAN_CACHE_OFF) {
+        return 0;
+    }
+
+    FILE *file = fopen(report_path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    char *report = NULL;
+    size_t report_len = 0, capacity = 0, n;
+    do {
+        if (report_len == capacity) {
+            capacity = capacity ? capacity * 2 : 4096;
+            char *grown = realloc(report, capacity);
+            if (!grown) {
+                free(report);
+                fclose(file);
+                return -1;
+            }
+            report = grown;
+        }
+        n = fread(report + report_len, 1, capacity - report_len, file);
+        report_len += n;
+    } while (n > 0);
+
+    int failed = ferror(file);
+    fclose(file);
+    int status = failed ? -1 : scan_cache_put(cache, key, result, report, report_len);
+    free(report);
+    return status;
+}
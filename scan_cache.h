@@ -0,0 +1,84 @@
+#ifndef SCAN_CACHE_H
+#define SCAN_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Content-addressed cache of query results. An entry is keyed by a hash of
+// the input file bytes plus the query parameters and holds the aggregates,
+// key positions and the report the program wrote. Entries live as files in
+// one directory and are evicted least-recently-used once their total size
+// exceeds the configured bound.
+//
+// Configured from the environment:
+//   SCAN_CACHE            off (default) | content | meta
+//                         "meta" trusts the input's path, size and mtime
+//                         instead of hashing its bytes on every lookup.
+//   SCAN_CACHE_DIR        cache directory (default .scancache)
+//   SCAN_CACHE_MAX_BYTES  size bound (default 64 MiB)
+#define SCAN_CACHE_ENV "SCAN_CACHE"
+#define SCAN_CACHE_DIR_ENV "SCAN_CACHE_DIR"
+#define SCAN_CACHE_MAX_BYTES_ENV "SCAN_CACHE_MAX_BYTES"
+#define SCAN_CACHE_DEFAULT_DIR ".scancache"
+#define SCAN_CACHE_DEFAULT_MAX_BYTES (64LL * 1024 * 1024)
+#define SCAN_CACHE_MAX_PARAMS 8
+
+enum scan_cache_mode {
+    SCAN_CACHE_OFF,
+    SCAN_CACHE_CONTENT,
+    SCAN_CACHE_METADATA,
+};
+
+struct scan_cache {
+    enum scan_cache_mode mode;
+    char dir[4096];
+    int64_t max_bytes;
+};
+
+struct scan_cache_key {
+    uint64_t id;                // names the entry
+    uint64_t content;           // hash of the input bytes
+    uint64_t meta;              // hash of path, size and mtime (metadata mode)
+    int64_t input_bytes;
+    char tag[16];               // which program/query kind the entry is for
+    int num_params;
+    int params[SCAN_CACHE_MAX_PARAMS];
+};
+
+// scan_hash_bytes() over a whole file, read in chunks.
+int scan_hash_file(const char *input, uint64_t *content);
+
+// Reads the configuration from the environment and creates the directory.
+// Returns 0 (mode may be SCAN_CACHE_OFF) or -1 with errno set.
+int scan_cache_from_env(struct scan_cache *cache);
+
+// Computes the key for running tag with params on the input file. In
+// metadata mode a previously recorded path/size/mtime match skips reading
+// the input altogether.
+int scan_cache_key(const struct scan_cache *cache, const char *input, const char *tag,
+                   const int *params, int num_params, struct scan_cache_key *key);
+
+// Returns 1 on a hit (result and *report filled, *report malloc'd and NUL
+// terminated), 0 on a miss, -1 on error.
+int scan_cache_get(const struct scan_cache *cache, const struct scan_cache_key *key,
+                   struct scan_result *result, char **report, size_t *report_len);
+
+// Stores an entry and evicts least-recently-used entries over the bound.
+int scan_cache_put(const struct scan_cache *cache, const struct scan_cache_key *key,
+                   const struct scan_result *result, const char *report, size_t report_len);
+
+// Same as scan_cache_put() with the report read from report_path.
+int scan_cache_put_file(const struct scan_cache *cache, const struct scan_cache_key *key,
+                        const struct scan_result *result, const char *report_path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "scan_checkpoint.h"
+
+#define CHECKPOINT_MAGIC 0x314b4353u /* "SCK1" */
+#define CHECKPOINT_VERSION 2
+
+struct checkpoint_header {
+    uint32_t magic;
+    uint32_t version;
+    int32_t segment_size;
+    int32_t num_segments;
+};
+
+struct checkpoint_record {
+    uint64_t hash;
+    int64_t sum;
+    int32_t count;
+    int32_t max;
+    int32_t count_hidden;
+    int32_t reserved;
+};
+
+uint64_t scan_hash(const int *data, int start, int end) {
+    return scan_hash_bytes(data + start, end > start ? (size_t)(end - start) * sizeof(int) : 0, 0);
+}
+
+void scan_checkpoint_init(struct scan_checkpoint *ckpt) {
+    ckpt->segment_size = SCAN_CHECKPOINT_SEGMENT_SIZE;
+    ckpt->num_segments = 0;
+    ckpt->segments = NULL;
+}
+
+void scan_checkpoint_free(struct scan_checkpoint *ckpt) {
+    for (int i = 0; i < ckpt->num_segments; ++i) {
+        scan_result_free(&ckpt->segments[i].result);
+    }
+    free(ckpt->segments);
+    scan_checkpoint_init(ckpt);
+}
+
+static int alloc_segments(struct scan_checkpoint *ckpt, int num_segments) {
+    ckpt->segments = calloc(num_segments > 0 ? num_segments : 1, sizeof(*ckpt->segments));
+    if (!ckpt->segments) {
+        return -1;
+    }
+    for (int i = 0; i < num_segments; ++i) {
+        scan_result_init(&ckpt->segments[i].result);
+    }
+    ckpt->num_segments = num_segments;
+    return 0;
+}
+
+int scan_checkpoint_load(const char *path, struct scan_checkpoint *ckpt) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    // Every segment takes at least one record, which bounds the count a
+    // damaged header can ask us to allocate.
+    struct checkpoint_header header;
+    struct stat st;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != CHECKPOINT_MAGIC ||
+        header.version != CHECKPOINT_VERSION || header.segment_size < 1 || header.num_segments < 0 ||
+        fstat(fileno(file), &st) == -1 ||
+        (uint64_t)header.num_segments > (st.st_size - sizeof(header)) / sizeof(struct checkpoint_record)) {
+        fclose(file);
+        errno = EINVAL;
+        return -1;
+    }
+
+    scan_checkpoint_free(ckpt);
+    if (alloc_segments(ckpt, header.num_segments) == -1) {
+        fclose(file);
+        return -1;
+    }
+    ckpt->segment_size = header.segment_size;
+
+    for (int i = 0; i < header.num_segments; ++i) {
+        struct checkpoint_record record;
+        struct scan_result *result = &ckpt->segments[i].result;
+
+        if (fread(&record, sizeof(record), 1, file) != 1 || record.count < 0 || record.count > header.segment_size ||
+            record.count_hidden < 0 || record.count_hidden > record.count) {
+            goto corrupt;
+        }
+        result->key_positions = malloc((record.count_hidden > 0 ? record.count_hidden : 1) * sizeof(int));
+        if (!result->key_positions) {
+            scan_checkpoint_free(ckpt);
+            fclose(file);
+            return -1;
+        }
+        result->key_capacity = record.count_hidden > 0 ? record.count_hidden : 1;
+        if ((int)fread(result->key_positions, sizeof(int), record.count_hidden, file) != record.count_hidden) {
+            goto corrupt;
+        }
+
+        ckpt->segments[i].hash = record.hash;
+        result->count = record.count;
+        result->max = record.max;
+        result->sum = record.sum;
+        result->avg = record.count ? (double)record.sum / record.count : 0.0;
+        result->count_hidden = record.count_hidden;
+    }
+
+    fclose(file);
+    return 0;
+
+corrupt:
+    scan_checkpoint_free(ckpt);
+    fclose(file);
+    errno = EINVAL;
+    return -1;
+}
+
+int scan_checkpoint_save(const char *path, const struct scan_checkpoint *ckpt) {
+    char tmp_path[4096];
+    if (snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path) >= (int)sizeof(tmp_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    struct checkpoint_header header = {
+        .magic = CHECKPOINT_MAGIC,
+        .version = CHECKPOINT_VERSION,
+        .segment_size = ckpt->segment_size,
+        .num_segments = ckpt->num_segments,
+    };
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+
+    for (int i = 0; ok && i < ckpt->num_segments; ++i) {
+        const struct scan_result *result = &ckpt->segments[i].result;
+        struct checkpoint_record record = {
+            .hash = ckpt->segments[i].hash,
+            .sum = result->sum,
+            .count = result->count,
+            .max = result->max,
+            .count_hidden = result->count_hidden,
+        };
+        ok = fwrite(&record, sizeof(record), 1, file) == 1 &&
+             (int)fwrite(result->key_positions, sizeof(int), result->count_hidden, file) == result->count_hidden;
+    }
+
+    if (fclose(file) != 0 || !ok) {
+        remove(tmp_path);
+        return -1;
+    }
+    return rename(tmp_path, path);
+}
+
+static int refresh(const int *data, int size, const char *checkpoint_path, int trust_prefix, struct scan_result *result,
+                   int *rescanned) {
+    struct scan_checkpoint old, current;
+    scan_checkpoint_init(&old);
+    scan_checkpoint_init(&current);
+
+    // Only a failing disk stops the run; a missing, damaged or unreadable
+    // checkpoint is just rescanned and then replaced.
+    if (scan_checkpoint_load(checkpoint_path, &old) == -1 && errno == EIO) {
+        return -1;
+    }
+
+    int segment_size = SCAN_CHECKPOINT_SEGMENT_SIZE;
+    int num_segments = (size + segment_size - 1) / segment_size;
+    if (alloc_segments(&current, num_segments) == -1) {
+        scan_checkpoint_free(&old);
+        return -1;
+    }
+
+    // Old summaries are only reusable if they were cut the same way.
+    int reusable = old.segment_size == segment_size ? old.num_segments : 0;
+    int scanned = 0;
+
+    scan_result_free(result);
+    for (int idx = 0; idx < num_segments; ++idx) {
+        int start = idx * segment_size;
+        int end = start + segment_size < size ? start + segment_size : size;
+        struct scan_checkpoint_segment *segment = &current.segments[idx];
+
+        // A full segment from the last run is trusted as is when the caller
+        // vouches that the data only grew; anything else is hashed.
+        int trusted = trust_prefix && idx < reusable && end - start == segment_size &&
+                      old.segments[idx].result.count == segment_size;
+        segment->hash = trusted ? old.segments[idx].hash : scan_hash(data, start, end);
+        if (idx < reusable && old.segments[idx].hash == segment->hash && old.segments[idx].result.count == end - start &&
+            scan_result_valid(&old.segments[idx].result, start, end)) {
+            // Take ownership of the cached summary instead of copying it.
+            segment->result = old.segments[idx].result;
+            scan_result_init(&old.segments[idx].result);
+        } else {
+            if (scan_segment(data, start, end, &segment->result) == -1) {
+                goto fail;
+            }
+            scanned++;
+        }
+
+        if (scan_result_merge(result, &segment->result) == -1) {
+            goto fail;
+        }
+    }
+
+    if (rescanned) {
+        *rescanned = scanned;
+    }
+
+    int status = scan_checkpoint_save(checkpoint_path, &current);
+    scan_checkpoint_free(&old);
+    scan_checkpoint_free(&current);
+    return status;
+
+fail:
+    scan_checkpoint_free(&old);
+    scan_checkpoint_free(&current);
+    return -1;
+}
+
+int scan_incremental(const int *data, int size, const char *checkpoint_path, struct scan_result *result, int *rescanned) {
+    return refresh(data, size, checkpoint_path, 0, result, rescanned);
+}
+
+int scan_incremental_append(const int *data, int size, const char *checkpoint_path, struct scan_result *result,
+                            int *rescanned) {
+    return refresh(data, size, checkpoint_path, 1, result, rescanned);
+}
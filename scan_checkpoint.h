@@ -0,0 +1,59 @@
+#ifndef SCAN_CHECKPOINT_H
+#define SCAN_CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Checkpoints cut the input into fixed-size segments so that appending data
+// leaves the boundaries (and summaries) of the earlier segments unchanged.
+#define SCAN_CHECKPOINT_SEGMENT_SIZE 4096
+#define SCAN_CHECKPOINT_SUFFIX ".ckpt"
+
+struct scan_checkpoint_segment {
+    uint64_t hash;              // scan_hash() of the segment contents
+    struct scan_result result;
+};
+
+struct scan_checkpoint {
+    int segment_size;
+    int num_segments;
+    struct scan_checkpoint_segment *segments;
+};
+
+// scan_hash_bytes() of the values of data[start, end).
+uint64_t scan_hash(const int *data, int start, int end);
+
+void scan_checkpoint_init(struct scan_checkpoint *ckpt);
+void scan_checkpoint_free(struct scan_checkpoint *ckpt);
+
+// Returns 0 or -1 with errno set (ENOENT when there is no checkpoint yet,
+// EINVAL when the file is corrupt or from another format version).
+int scan_checkpoint_load(const char *path, struct scan_checkpoint *ckpt);
+
+// Writes to a temporary file and renames it over path.
+int scan_checkpoint_save(const char *path, const struct scan_checkpoint *ckpt);
+
+// Scans data using the checkpoint at checkpoint_path: segments whose hash is
+// unchanged are taken from the checkpoint, new or modified ones are rescanned,
+// and the refreshed checkpoint is written back. A missing or unusable
+// checkpoint just means every segment is rescanned, and a stored summary
+// whose key positions do not fit its segment is rescanned too. If rescanned is not NULL
+// it receives the number of segments that had to be scanned.
+int scan_incremental(const int *data, int size, const char *checkpoint_path, struct scan_result *result, int *rescanned);
+
+// Like scan_incremental(), for inputs that are only ever appended to: the
+// full segments of the last run are reused without hashing them, so only
+// the tail has to be read. Changes inside that prefix go unnoticed.
+int scan_incremental_append(const int *data, int size, const char *checkpoint_path, struct scan_result *result,
+                            int *rescanned);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
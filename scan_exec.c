@@ -0,0 +1,464 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/wait.h>
+
+#include "scan_exec.h"
+#include "scan_progress.h"
+
+#define CALIBRATION_SCAN_ELEMENTS (1 << 20)
+#define CALIBRATION_FORK_MB 64
+#define CALIBRATION_ROUNDS 16
+#define CALIBRATION_MESSAGES 1000
+
+// Fixed part of a result sent up a pipe; key positions follow.
+struct result_message {
+    int64_t sum;
+    int32_t count;
+    int32_t max;
+    int32_t count_hidden;
+    int32_t status;
+};
+
+struct thread_task {
+    const int *data;
+    int start;
+    int end;
+    int status;
+    struct scan_result result;
+};
+
+static const char *mode_names[] = {"auto", "serial", "flat", "tree", "threads"};
+
+const char *scan_exec_mode_name(enum scan_exec_mode mode) {
+    return mode >= SCAN_EXEC_AUTO && mode <= SCAN_EXEC_THREADS ? mode_names[mode] : "?";
+}
+
+int scan_exec_parse_mode(const char *name, enum scan_exec_mode *mode) {
+    for (int m = SCAN_EXEC_AUTO; m <= SCAN_EXEC_THREADS; ++m) {
+        if (strcmp(name, mode_names[m]) == 0) {
+            *mode = m;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int write_result(int fd, int status, const struct scan_result *result) {
+    struct result_message message = {
+        .sum = result->sum,
+        .count = result->count,
+        .max = result->max,
+        .count_hidden = status == 0 ? result->count_hidden : 0,
+        .status = status,
+    };
+    if (scan_write_all(fd, &message, sizeof(message)) == -1) {
+        return -1;
+    }
+    return scan_write_all(fd, result->key_positions, message.count_hidden * sizeof(int));
+}
+
+static int read_result(int fd, struct scan_result *result) {
+    struct result_message message;
+    if (scan_read_all(fd, &message, sizeof(message)) == -1) {
+        return -1;
+    }
+    if (message.status != 0 || message.count_hidden < 0 || scan_result_reserve(result, message.count_hidden) == -1 ||
+        scan_read_all(fd, result->key_positions, message.count_hidden * sizeof(int)) == -1) {
+        errno = message.status != 0 ? EIO : errno;
+        return -1;
+    }
+    result->count = message.count;
+    result->max = message.max;
+    result->sum = message.sum;
+    result->avg = message.count ? (double)message.sum / message.count : 0.0;
+    result->count_hidden = message.count_hidden;
+    return 0;
+}
+
+// Scans leaf segments [first, first + count) of a leaves-way split. Nodes
+// with more than one leaf fork fanout children, each taking count / fanout
+// leaves, and merge what the children send back in order.
+static int fork_node(const int *data, int size, int leaves, int first, int count, int fanout,
+                     struct scan_result *result) {
+    if (count == 1) {
+        int start, end;
+        scan_segment_bounds(size, leaves, first, &start, &end);
+        return scan_segment(data, start, end, result);
+    }
+
+    int per_child = count / fanout;
+    int read_fds[SCAN_EXEC_MAX_WORKERS];
+    pid_t pids[SCAN_EXEC_MAX_WORKERS];
+    int children = 0, status = 0;
+
+    for (int i = 0; i < fanout; ++i) {
+        int pipefd[2];
+        if (pipe(pipefd) == -1) {
+            status = -1;
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0) { // Child process
+            close(pipefd[0]);
+            for (int j = 0; j < children; ++j) {
+                close(read_fds[j]);
+            }
+            struct scan_result child;
+            scan_result_init(&child);
+            int child_status = fork_node(data, size, leaves, first + i * per_child, per_child, SCAN_EXEC_TREE_FANOUT, &child);
+            int io = write_result(pipefd[1], child_status, &child);
+            _exit(child_status == 0 && io == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+        } else if (pid < 0) {
+            close(pipefd[0]);
+            close(pipefd[1]);
+            status = -1;
+            break;
+        }
+
+        close(pipefd[1]);
+        read_fds[children] = pipefd[0];
+        pids[children] = pid;
+        children++;
+    }
+
+    struct scan_result child;
+    scan_result_init(&child);
+    scan_result_free(result);
+    for (int i = 0; i < children; ++i) {
+        if (status == 0 && (read_result(read_fds[i], &child) == -1 || scan_result_merge(result, &child) == -1)) {
+            status = -1;
+        }
+        close(read_fds[i]);
+    }
+    for (int i = 0; i < children; ++i) {
+        int wstatus;
+        if (waitpid(pids[i], &wstatus, 0) == -1 || !WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != EXIT_SUCCESS) {
+            status = -1;
+        }
+    }
+    scan_result_free(&child);
+    return status;
+}
+
+static void *thread_main(void *arg) {
+    struct thread_task *task = arg;
+    task->status = scan_segment(task->data, task->start, task->end, &task->result);
+    return NULL;
+}
+
+static int thread_scan(const int *data, int size, int workers, struct scan_result *result) {
+    struct thread_task *tasks = calloc(workers, sizeof(*tasks));
+    pthread_t *threads = calloc(workers, sizeof(*threads));
+    char *joinable = calloc(workers, 1);
+    if (!tasks || !threads || !joinable) {
+        free(tasks);
+        free(threads);
+        free(joinable);
+        return -1;
+    }
+
+    for (int i = 0; i < workers; ++i) {
+        tasks[i].data = data;
+        scan_segment_bounds(size, workers, i, &tasks[i].start, &tasks[i].end);
+        scan_result_init(&tasks[i].result);
+        // The calling thread takes the last segment, and any a thread could not be started for.
+        if (i < workers - 1 && pthread_create(&threads[i], NULL, thread_main, &tasks[i]) == 0) {
+            joinable[i] = 1;
+        } else {
+            thread_main(&tasks[i]);
+        }
+    }
+
+    int status = 0;
+    scan_result_free(result);
+    for (int i = 0; i < workers; ++i) {
+        if (joinable[i]) {
+            pthread_join(threads[i], NULL);
+        }
+        if (status == 0 && (tasks[i].status == -1 || scan_result_merge(result, &tasks[i].result) == -1)) {
+            status = -1;
+        }
+        scan_result_free(&tasks[i].result);
+    }
+
+    free(tasks);
+    free(threads);
+    free(joinable);
+    return status;
+}
+
+static int tree_depth(int leaves) {
+    int depth = 0;
+    for (int n = 1; n < leaves; n *= SCAN_EXEC_TREE_FANOUT) {
+        depth++;
+    }
+    return depth;
+}
+
+double scan_exec_cost(const struct scan_cost_model *model, enum scan_exec_mode mode, int workers, int size) {
+    int parallel = workers < model->cores ? workers : model->cores;
+    double scan = size * model->scan_ns_per_element;
+    double fork_cost = model->fork_ns + model->fork_ns_per_mb * ((double)size * sizeof(int) / (1 << 20));
+
+    if (parallel < 1) {
+        parallel = 1;
+    }
+
+    switch (mode) {
+    case SCAN_EXEC_SERIAL:
+        return scan;
+    case SCAN_EXEC_THREADS:
+        return (workers - 1) * model->thread_ns + scan / parallel;
+    case SCAN_EXEC_FLAT:
+        // The parent forks and collects every worker itself.
+        return workers * (fork_cost + model->pipe_ns) + scan / parallel;
+    case SCAN_EXEC_TREE: {
+        // Along the critical path each level forks and collects its own children.
+        int depth = tree_depth(workers);
+        return depth * SCAN_EXEC_TREE_FANOUT * (fork_cost + model->pipe_ns) + scan / parallel;
+    }
+    default:
+        return -1.0;
+    }
+}
+
+void scan_exec_choose(const struct scan_cost_model *model, int size, enum scan_exec_mode *mode, int *workers) {
+    int max_workers = model->cores < SCAN_EXEC_MAX_WORKERS ? model->cores : SCAN_EXEC_MAX_WORKERS;
+    double best = scan_exec_cost(model, SCAN_EXEC_SERIAL, 1, size);
+    *mode = SCAN_EXEC_SERIAL;
+    *workers = 1;
+
+    // Candidate counts: powers of two up to the core count, and the core count itself.
+    for (int p = 2; p <= max_workers; p = p < max_workers && p * 2 > max_workers ? max_workers : p * 2) {
+        enum scan_exec_mode candidates[] = {SCAN_EXEC_THREADS, SCAN_EXEC_FLAT};
+        for (int c = 0; c < 2; ++c) {
+            double cost = scan_exec_cost(model, candidates[c], p, size);
+            if (cost < best) {
+                best = cost;
+                *mode = candidates[c];
+                *workers = p;
+            }
+        }
+    }
+
+    for (int leaves = SCAN_EXEC_TREE_FANOUT, depth = 1; depth <= SCAN_EXEC_MAX_TREE_DEPTH;
+         leaves *= SCAN_EXEC_TREE_FANOUT, ++depth) {
+        double cost = scan_exec_cost(model, SCAN_EXEC_TREE, leaves, size);
+        if (cost < best) {
+            best = cost;
+            *mode = SCAN_EXEC_TREE;
+            *workers = leaves;
+        }
+    }
+}
+
+int scan_exec(const int *data, int size, enum scan_exec_mode *mode, int *workers, struct scan_result *result) {
+    if (*mode == SCAN_EXEC_AUTO) {
+        struct scan_cost_model model;
+        if (scan_cost_model_get(&model, 0) == -1) {
+            *mode = SCAN_EXEC_SERIAL;
+            *workers = 1;
+        } else {
+            scan_exec_choose(&model, size, mode, workers);
+        }
+    }
+
+    if (*workers < 1 || *workers > SCAN_EXEC_MAX_WORKERS) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    switch (*mode) {
+    case SCAN_EXEC_SERIAL:
+        *workers = 1;
+        return scan_data(data, size, 1, result);
+    case SCAN_EXEC_THREADS:
+        return thread_scan(data, size, *workers, result);
+    case SCAN_EXEC_FLAT:
+        return fork_node(data, size, *workers, 0, *workers, *workers, result);
+    case SCAN_EXEC_TREE: {
+        if (*workers > SCAN_EXEC_MAX_TREE_LEAVES) {
+            errno = EINVAL;
+            return -1;
+        }
+        // Round the leaf count up to a full tree.
+        int leaves = 1;
+        while (leaves < *workers) {
+            leaves *= SCAN_EXEC_TREE_FANOUT;
+        }
+        *workers = leaves;
+        return fork_node(data, size, leaves, 0, leaves, SCAN_EXEC_TREE_FANOUT, result);
+    }
+    default:
+        errno = EINVAL;
+        return -1;
+    }
+}
+
+static double measure_fork(int rounds) {
+    int64_t begin = scan_progress_now_ns();
+    for (int i = 0; i < rounds; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(0);
+        } else if (pid > 0) {
+            waitpid(pid, NULL, 0);
+        }
+    }
+    return (double)(scan_progress_now_ns() - begin) / rounds;
+}
+
+int scan_calibrate(struct scan_cost_model *model) {
+    memset(model, 0, sizeof(*model));
+    gethostname(model->host, sizeof(model->host) - 1);
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    model->cores = cores > 0 ? (int)cores : 1;
+
+    // Scan rate: best of a few passes over a synthetic buffer.
+    int *buf = malloc(CALIBRATION_SCAN_ELEMENTS * sizeof(int));
+    if (!buf) {
+        return -1;
+    }
+    for (int i = 0; i < CALIBRATION_SCAN_ELEMENTS; ++i) {
+        buf[i] = i % 1000 == 0 ? -(i % 60) - 1 : (int)((i * 7919u) % MAX_POSITIVE_INT) + 1;
+    }
+    struct scan_result result;
+    scan_result_init(&result);
+    int64_t best = INT64_MAX;
+    for (int round = 0; round < 5; ++round) {
+        int64_t begin = scan_progress_now_ns();
+        scan_segment(buf, 0, CALIBRATION_SCAN_ELEMENTS, &result);
+        int64_t elapsed = scan_progress_now_ns() - begin;
+        best = elapsed < best ? elapsed : best;
+    }
+    scan_result_free(&result);
+    free(buf);
+    model->scan_ns_per_element = (double)best / CALIBRATION_SCAN_ELEMENTS;
+
+    // Fork cost grows with the page tables the child has to copy.
+    model->fork_ns = measure_fork(CALIBRATION_ROUNDS);
+    size_t big = (size_t)CALIBRATION_FORK_MB << 20;
+    char *ballast = malloc(big);
+    if (ballast) {
+        memset(ballast, 1, big);
+        double fork_big = measure_fork(CALIBRATION_ROUNDS / 2);
+        model->fork_ns_per_mb = fork_big > model->fork_ns ? (fork_big - model->fork_ns) / CALIBRATION_FORK_MB : 0.0;
+        free(ballast);
+    }
+
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        return -1;
+    }
+    char message[sizeof(struct result_message)];
+    memset(message, 0, sizeof(message));
+    int64_t begin = scan_progress_now_ns();
+    for (int i = 0; i < CALIBRATION_MESSAGES; ++i) {
+        if (scan_write_all(pipefd[1], message, sizeof(message)) == -1 || scan_read_all(pipefd[0], message, sizeof(message)) == -1) {
+            break;
+        }
+    }
+    model->pipe_ns = (double)(scan_progress_now_ns() - begin) / CALIBRATION_MESSAGES;
+
+    close(pipefd[0]);
+    close(pipefd[1]);
+
+    begin = scan_progress_now_ns();
+    for (int i = 0; i < CALIBRATION_ROUNDS; ++i) {
+        pthread_t thread;
+        struct thread_task task = {.data = NULL, .start = 0, .end = 0};
+        scan_result_init(&task.result);
+        if (pthread_create(&thread, NULL, thread_main, &task) == 0) {
+            pthread_join(thread, NULL);
+        }
+    }
+    model->thread_ns = (double)(scan_progress_now_ns() - begin) / CALIBRATION_ROUNDS;
+    return 0;
+}
+
+static void calibration_path(char *path, size_t len) {
+    const char *env = getenv(SCAN_CALIBRATION_ENV);
+    const char *home = getenv("HOME");
+    if (env && *env) {
+        snprintf(path, len, "%s", env);
+    } else if (home && *home) {
+        snprintf(path, len, "%s/%s", home, SCAN_CALIBRATION_DEFAULT_NAME);
+    } else {
+        snprintf(path, len, "%s", SCAN_CALIBRATION_DEFAULT_NAME);
+    }
+}
+
+static int load_model(const char *path, struct scan_cost_model *model) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    memset(model, 0, sizeof(*model));
+    char line[256];
+    int fields = 0;
+    while (fgets(line, sizeof(line), file)) {
+        char key[64];
+        char value[128];
+        if (sscanf(line, "%63[^=]=%127s", key, value) != 2) {
+            continue;
+        }
+        fields++;
+        if (strcmp(key, "host") == 0) snprintf(model->host, sizeof(model->host), "%s", value);
+        else if (strcmp(key, "cores") == 0) model->cores = atoi(value);
+        else if (strcmp(key, "scan_ns_per_element") == 0) model->scan_ns_per_element = atof(value);
+        else if (strcmp(key, "fork_ns") == 0) model->fork_ns = atof(value);
+        else if (strcmp(key, "fork_ns_per_mb") == 0) model->fork_ns_per_mb = atof(value);
+        else if (strcmp(key, "pipe_ns") == 0) model->pipe_ns = atof(value);
+        else if (strcmp(key, "thread_ns") == 0) model->thread_ns = atof(value);
+        else fields--;
+    }
+    fclose(file);
+
+    if (fields != 7 || model->cores < 1 || model->scan_ns_per_element <= 0.0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+static int save_model(const char *path, const struct scan_cost_model *model) {
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        return -1;
+    }
+    fprintf(file, "host=%s\n", model->host);
+    fprintf(file, "cores=%d\n", model->cores);
+    fprintf(file, "scan_ns_per_element=%.6f\n", model->scan_ns_per_element);
+    fprintf(file, "fork_ns=%.1f\n", model->fork_ns);
+    fprintf(file, "fork_ns_per_mb=%.1f\n", model->fork_ns_per_mb);
+    fprintf(file, "pipe_ns=%.1f\n", model->pipe_ns);
+    fprintf(file, "thread_ns=%.1f\n", model->thread_ns);
+    return fclose(file) == 0 ? 0 : -1;
+}
+
+int scan_cost_model_get(struct scan_cost_model *model, int recalibrate) {
+    char path[4096];
+    calibration_path(path, sizeof(path));
+
+    if (!recalibrate && load_model(path, model) == 0) {
+        char host[64] = {0};
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        gethostname(host, sizeof(host) - 1);
+        if (strcmp(host, model->host) == 0 && cores == model->cores) {
+            return 0;
+        }
+    }
+
+    if (scan_calibrate(model) == -1) {
+        return -1;
+    }
+    // A cache that cannot be written only costs a calibration next time.
+    save_model(path, model);
+    return 0;
+}
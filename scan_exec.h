@@ -0,0 +1,70 @@
+#ifndef SCAN_EXEC_H
+#define SCAN_EXEC_H
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Execution strategies for a full scan and a cost model to choose among
+// them. The model is calibrated once per host and cached in
+// $SCAN_CALIBRATION, or $HOME/.datascan-calibration by default.
+#define SCAN_CALIBRATION_ENV "SCAN_CALIBRATION"
+#define SCAN_CALIBRATION_DEFAULT_NAME ".datascan-calibration"
+#define SCAN_EXEC_TREE_FANOUT 4
+#define SCAN_EXEC_MAX_TREE_DEPTH 3
+// SCAN_EXEC_TREE_FANOUT ^ SCAN_EXEC_MAX_TREE_DEPTH
+#define SCAN_EXEC_MAX_TREE_LEAVES 64
+#define SCAN_EXEC_MAX_WORKERS 256
+
+enum scan_exec_mode {
+    SCAN_EXEC_AUTO,
+    SCAN_EXEC_SERIAL,           // one loop in the calling process
+    SCAN_EXEC_FLAT,             // the parent forks every worker, as project1DFS does
+    SCAN_EXEC_TREE,             // every node forks SCAN_EXEC_TREE_FANOUT children, as project1BFS does
+    SCAN_EXEC_THREADS,          // one thread per worker
+};
+
+struct scan_cost_model {
+    char host[64];
+    int cores;
+    double scan_ns_per_element;
+    double fork_ns;             // fork + exit + wait of a small process
+    double fork_ns_per_mb;      // extra fork cost per MiB of parent memory
+    double pipe_ns;             // one small message through a pipe
+    double thread_ns;           // create + join
+};
+
+const char *scan_exec_mode_name(enum scan_exec_mode mode);
+
+// Parses "auto", "serial", "flat", "tree" or "threads". Returns -1 if unknown.
+int scan_exec_parse_mode(const char *name, enum scan_exec_mode *mode);
+
+// Measures the model on this host.
+int scan_calibrate(struct scan_cost_model *model);
+
+// Loads the cached model for this host, calibrating and caching it first
+// if there is none (or it was measured on another host). Set recalibrate
+// to ignore the cache.
+int scan_cost_model_get(struct scan_cost_model *model, int recalibrate);
+
+// Predicted wall time in nanoseconds of scanning size elements.
+double scan_exec_cost(const struct scan_cost_model *model, enum scan_exec_mode mode, int workers, int size);
+
+// Picks the cheapest mode and worker count for size elements. For the tree
+// mode, workers is the number of leaves (a power of SCAN_EXEC_TREE_FANOUT).
+void scan_exec_choose(const struct scan_cost_model *model, int size, enum scan_exec_mode *mode, int *workers);
+
+// Scans data with the given strategy; the result is the same for every mode.
+// SCAN_EXEC_AUTO consults the cached cost model and reports its choice
+// through mode and workers. Workers must be at most SCAN_EXEC_MAX_WORKERS,
+// or SCAN_EXEC_MAX_TREE_LEAVES for the tree, which rounds it up to a power
+// of SCAN_EXEC_TREE_FANOUT. Returns -1 with errno EINVAL otherwise.
+int scan_exec(const int *data, int size, enum scan_exec_mode *mode, int *workers, struct scan_result *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
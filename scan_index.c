@@ -0,0 +1,351 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "scan_index.h"
+#include "scan_cache.h"
+
+#define INDEX_MAGIC 0x31584449u /* "IDX1" */
+#define INDEX_VERSION 2
+
+// Identity of the input file when it was last hashed. A match lets a load
+// trust the stored hash without rereading the input.
+struct index_stamp {
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+    uint64_t ino;
+    uint64_t dev;
+};
+
+struct index_header {
+    uint32_t magic;
+    uint32_t version;
+    int64_t input_bytes;
+    uint64_t input_hash;
+    struct index_stamp stamp;
+    int32_t size;
+    int32_t all_count;
+    uint64_t all_len;
+    int32_t counts[SCAN_INDEX_VALUES];
+    uint64_t lens[SCAN_INDEX_VALUES];
+};
+
+void scan_index_init(struct scan_index *index) {
+    memset(index, 0, sizeof(*index));
+}
+
+void scan_index_free(struct scan_index *index) {
+    for (int v = 0; v < SCAN_INDEX_VALUES; ++v) {
+        free(index->values[v].bytes);
+    }
+    free(index->all.bytes);
+    scan_index_init(index);
+}
+
+static int list_reserve(struct scan_index_list *list, size_t extra) {
+    if (list->len + extra <= list->capacity) {
+        return 0;
+    }
+    size_t capacity = list->capacity ? list->capacity : 64;
+    while (capacity < list->len + extra) {
+        capacity *= 2;
+    }
+    uint8_t *bytes = realloc(list->bytes, capacity);
+    if (!bytes) {
+        return -1;
+    }
+    list->bytes = bytes;
+    list->capacity = capacity;
+    return 0;
+}
+
+// LEB128: 7 bits per byte, high bit set on every byte but the last.
+static int put_varint(struct scan_index_list *list, uint32_t value) {
+    if (list_reserve(list, 5) == -1) {
+        return -1;
+    }
+    while (value >= 0x80) {
+        list->bytes[list->len++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    list->bytes[list->len++] = (uint8_t)value;
+    return 0;
+}
+
+// Decodes one varint from [*p, end). Returns -1 if it runs past end.
+static int get_varint(const uint8_t **p, const uint8_t *end, uint32_t *value) {
+    uint32_t v = 0;
+    for (int shift = 0; *p < end && shift < 35; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int scan_index_build(const int *data, int size, const struct scan_result *result, struct scan_index *index) {
+    int last[SCAN_INDEX_VALUES] = {0};
+    int last_all = 0;
+
+    scan_index_free(index);
+    index->size = size;
+
+    for (int k = 0; k < result->count_hidden; ++k) {
+        int pos = result->key_positions[k];
+        int v = data[pos] - HIDDEN_KEY_LOWER_BOUND;
+        struct scan_index_list *list = &index->values[v];
+
+        if (put_varint(list, pos - last[v]) == -1 || put_varint(&index->all, pos - last_all) == -1 ||
+            list_reserve(&index->all, 1) == -1) {
+            scan_index_free(index);
+            return -1;
+        }
+        index->all.bytes[index->all.len++] = (uint8_t)v;
+        list->count++;
+        index->all.count++;
+        last[v] = pos;
+        last_all = pos;
+    }
+    return 0;
+}
+
+static void get_stamp(const struct stat *st, struct index_stamp *stamp) {
+    memset(stamp, 0, sizeof(*stamp));
+    stamp->mtime_ns = st->st_mtim.tv_sec * 1000000000LL + st->st_mtim.tv_nsec;
+    stamp->ctime_ns = st->st_ctim.tv_sec * 1000000000LL + st->st_ctim.tv_nsec;
+    stamp->ino = st->st_ino;
+    stamp->dev = st->st_dev;
+}
+
+int scan_index_save(const char *path, const char *input, struct scan_index *index) {
+    // Stat before hashing: a write that lands during the hash leaves a newer
+    // mtime than the one stored, so the next load rehashes instead of
+    // trusting a stale hash.
+    struct stat st;
+    if (stat(input, &st) == -1 || scan_hash_file(input, &index->input_hash) == -1) {
+        return -1;
+    }
+    index->input_bytes = st.st_size;
+
+    struct index_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = INDEX_MAGIC;
+    header.version = INDEX_VERSION;
+    header.input_bytes = index->input_bytes;
+    header.input_hash = index->input_hash;
+    get_stamp(&st, &header.stamp);
+    header.size = index->size;
+    header.all_count = index->all.count;
+    header.all_len = index->all.len;
+    for (int v = 0; v < SCAN_INDEX_VALUES; ++v) {
+        header.counts[v] = index->values[v].count;
+        header.lens[v] = index->values[v].len;
+    }
+
+    char tmp_path[4200];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "wb");
+    if (!file) {
+        return -1;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (int v = 0; ok && v < SCAN_INDEX_VALUES; ++v) {
+        ok = fwrite(index->values[v].bytes, 1, index->values[v].len, file) == index->values[v].len;
+    }
+    ok = ok && fwrite(index->all.bytes, 1, index->all.len, file) == index->all.len;
+
+    if (fclose(file) != 0 || !ok) {
+        remove(tmp_path);
+        return -1;
+    }
+    return rename(tmp_path, path);
+}
+
+static int read_list(FILE *file, struct scan_index_list *list, uint64_t len, int count) {
+    if (list_reserve(list, len) == -1) {
+        return -1;
+    }
+    if (fread(list->bytes, 1, len, file) != len) {
+        errno = EINVAL;
+        return -1;
+    }
+    list->len = len;
+    list->count = count;
+    return 0;
+}
+
+// Checks that the counts and lengths agree with each other and with the
+// file size: every key takes at least one byte per list, so a list can
+// never hold more keys than bytes.
+static int header_valid(const struct index_header *header, off_t file_size) {
+    int64_t keys = 0;
+    uint64_t bytes = sizeof(*header) + header->all_len;
+    if (header->size < 0 || header->all_count < 0 || header->all_count > header->size ||
+        header->all_len < 2 * (uint64_t)header->all_count) {
+        return 0;
+    }
+    for (int v = 0; v < SCAN_INDEX_VALUES; ++v) {
+        if (header->counts[v] < 0 || header->lens[v] < (uint64_t)header->counts[v] || header->lens[v] > (uint64_t)file_size) {
+            return 0;
+        }
+        keys += header->counts[v];
+        bytes += header->lens[v];
+    }
+    return keys == header->all_count && header->all_len <= (uint64_t)file_size && bytes == (uint64_t)file_size;
+}
+
+// Decodes a whole list: exactly count entries must fill len bytes, with
+// positions inside the input. In the "all" stream each delta is followed
+// by a value byte.
+static int list_valid(const struct scan_index_list *list, int with_values, int size) {
+    const uint8_t *p = list->bytes;
+    const uint8_t *end = p + list->len;
+    int64_t pos = 0;
+    for (int n = 0; n < list->count; ++n) {
+        uint32_t delta;
+        if (get_varint(&p, end, &delta) == -1 || (n > 0 && delta == 0) || (pos += delta) >= size) {
+            return 0;
+        }
+        if (with_values && (p == end || *p++ >= SCAN_INDEX_VALUES)) {
+            return 0;
+        }
+    }
+    return p == end;
+}
+
+// Best effort: an index that cannot be updated is just rehashed next time.
+static void update_stamp(const char *path, const struct index_stamp *stamp) {
+    FILE *file = fopen(path, "r+b");
+    if (!file) {
+        return;
+    }
+    if (fseek(file, offsetof(struct index_header, stamp), SEEK_SET) == 0) {
+        fwrite(stamp, sizeof(*stamp), 1, file);
+    }
+    fclose(file);
+}
+
+int scan_index_load(const char *path, const char *input, struct scan_index *index) {
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return -1;
+    }
+
+    struct index_header header;
+    struct stat index_st;
+    if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != INDEX_MAGIC ||
+        header.version != INDEX_VERSION || fstat(fileno(file), &index_st) == -1 ||
+        !header_valid(&header, index_st.st_size)) {
+        fclose(file);
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Same size, file and modification times as when the input was hashed
+    // means the stored hash still holds. Otherwise the content hash decides,
+    // so a touched or copied input keeps its index, and the new stamp is
+    // recorded for the next load.
+    struct stat st;
+    struct index_stamp stamp;
+    if (stat(input, &st) == -1) {
+        fclose(file);
+        return -1;
+    }
+    get_stamp(&st, &stamp);
+    if (st.st_size != header.input_bytes) {
+        fclose(file);
+        errno = ESTALE;
+        return -1;
+    }
+    if (memcmp(&stamp, &header.stamp, sizeof(stamp)) != 0) {
+        uint64_t hash;
+        if (scan_hash_file(input, &hash) == -1 || hash != header.input_hash) {
+            fclose(file);
+            errno = ESTALE;
+            return -1;
+        }
+        update_stamp(path, &stamp);
+    }
+
+    scan_index_free(index);
+    index->input_bytes = header.input_bytes;
+    index->input_hash = header.input_hash;
+    index->size = header.size;
+    for (int v = 0; v < SCAN_INDEX_VALUES; ++v) {
+        if (read_list(file, &index->values[v], header.lens[v], header.counts[v]) == -1) {
+            goto fail;
+        }
+        if (!list_valid(&index->values[v], 0, header.size)) {
+            goto corrupt;
+        }
+    }
+    if (read_list(file, &index->all, header.all_len, header.all_count) == -1) {
+        goto fail;
+    }
+    if (!list_valid(&index->all, 1, header.size)) {
+        goto corrupt;
+    }
+
+    fclose(file);
+    return 0;
+
+corrupt:
+    errno = EINVAL;
+fail:
+    scan_index_free(index);
+    fclose(file);
+    return -1;
+}
+
+int scan_index_count(const struct scan_index *index, int value) {
+    if (value < HIDDEN_KEY_LOWER_BOUND || value > HIDDEN_KEY_UPPER_BOUND) {
+        return 0;
+    }
+    return index->values[value - HIDDEN_KEY_LOWER_BOUND].count;
+}
+
+int scan_index_lookup(const struct scan_index *index, int value, int *positions, int max) {
+    int count = scan_index_count(index, value);
+    if (count == 0) {
+        return 0;
+    }
+
+    const struct scan_index_list *list = &index->values[value - HIDDEN_KEY_LOWER_BOUND];
+    const uint8_t *p = list->bytes;
+    const uint8_t *end = p + list->len;
+    int pos = 0, n = 0;
+    for (; n < count && n < max; ++n) {
+        uint32_t delta;
+        if (get_varint(&p, end, &delta) == -1) {
+            break;
+        }
+        pos += delta;
+        positions[n] = pos;
+    }
+    return n;
+}
+
+int scan_index_first(const struct scan_index *index, int max, int *positions, int *values) {
+    const uint8_t *p = index->all.bytes;
+    const uint8_t *end = p + index->all.len;
+    int pos = 0, n = 0;
+    for (; n < index->all.count && n < max; ++n) {
+        uint32_t delta;
+        if (get_varint(&p, end, &delta) == -1 || p == end) {
+            break;
+        }
+        pos += delta;
+        positions[n] = pos;
+        if (values) {
+            values[n] = *p + HIDDEN_KEY_LOWER_BOUND;
+        }
+        p++;
+    }
+    return n;
+}
@@ -0,0 +1,65 @@
+#ifndef SCAN_INDEX_H
+#define SCAN_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Inverted index from hidden-key value to the positions holding it. Each
+// value keeps its positions as a delta + varint encoded ascending list, and
+// a second stream keeps every key in position order, so both lookups cost
+// time proportional to the number of positions returned.
+#define SCAN_INDEX_SUFFIX ".idx"
+#define SCAN_INDEX_VALUES (HIDDEN_KEY_UPPER_BOUND - HIDDEN_KEY_LOWER_BOUND + 1)
+
+struct scan_index_list {
+    uint8_t *bytes;
+    size_t len;
+    size_t capacity;
+    int count;
+};
+
+struct scan_index {
+    int64_t input_bytes;        // the input file this index was checked against
+    uint64_t input_hash;
+    int size;
+    struct scan_index_list values[SCAN_INDEX_VALUES];
+    struct scan_index_list all; // (delta, value) pairs in position order
+};
+
+void scan_index_init(struct scan_index *index);
+void scan_index_free(struct scan_index *index);
+
+// Builds the index from the key positions a scan already collected, so no
+// second pass over the data is needed.
+int scan_index_build(const int *data, int size, const struct scan_result *result, struct scan_index *index);
+
+// Saves the index together with the hash and file identity (inode, device,
+// modification times) of the input file it describes.
+int scan_index_save(const char *path, const char *input, struct scan_index *index);
+
+// Loads an index and checks it against the current input file, rehashing
+// the input only when its size matches but its identity does not. Returns -1
+// with errno ESTALE if the input has changed since the index was saved, or
+// EINVAL if the index file is damaged; either way it should be rebuilt.
+int scan_index_load(const char *path, const char *input, struct scan_index *index);
+
+// Number of positions holding value (0 for values outside the key range).
+int scan_index_count(const struct scan_index *index, int value);
+
+// Writes up to max positions of value, ascending. Returns how many were written.
+int scan_index_lookup(const struct scan_index *index, int value, int *positions, int max);
+
+// Writes the first max keys in position order. values may be NULL.
+int scan_index_first(const struct scan_index *index, int max, int *positions, int *values);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,373 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "scan_net.h"
+#include "scan_progress.h"
+
+#define SCAN_NET_MAGIC 0x53434e32u /* "SCN2" */
+
+struct agent {
+    int fd;
+    int segment;            // segment in flight, or -1 when idle
+    int64_t deadline_ns;
+};
+
+int scan_net_listen(int port, int *bound_port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    socklen_t addr_len = sizeof(addr);
+
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 || listen(fd, 16) == -1 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addr_len) == -1) {
+        close(fd);
+        return -1;
+    }
+    if (bound_port) {
+        *bound_port = ntohs(addr.sin_port);
+    }
+    return fd;
+}
+
+int scan_net_connect(const char *address) {
+    char host[256];
+    char port[16];
+    const char *colon = strrchr(address, ':');
+    size_t host_len = colon ? (size_t)(colon - address) : strlen(address);
+
+    if (host_len == 0 || host_len >= sizeof(host)) {
+        errno = EINVAL;
+        return -1;
+    }
+    memcpy(host, address, host_len);
+    host[host_len] = '\0';
+    snprintf(port, sizeof(port), "%s", colon ? colon + 1 : "");
+    if (!colon) {
+        snprintf(port, sizeof(port), "%d", SCAN_NET_DEFAULT_PORT);
+    }
+
+    struct addrinfo hints, *res;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host, port, &hints, &res) != 0) {
+        errno = EHOSTUNREACH;
+        return -1;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+
+    if (fd != -1) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+static int send_reply(int fd, int status, const struct scan_result *result) {
+    struct scan_net_reply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.magic = htonl(SCAN_NET_MAGIC);
+    reply.status = htonl(status);
+
+    if (status != SCAN_NET_OK) {
+        return scan_write_all(fd, &reply, sizeof(reply));
+    }
+
+    reply.count = htonl(result->count);
+    reply.max = htonl(result->max);
+    reply.sum_hi = htonl((uint32_t)((uint64_t)result->sum >> 32));
+    reply.sum_lo = htonl((uint32_t)result->sum);
+    reply.count_hidden = htonl(result->count_hidden);
+
+    // Header and positions go out in one send, so the reply is never split
+    // into a small segment waiting on a delayed ACK.
+    size_t len = sizeof(reply) + result->count_hidden * sizeof(int32_t);
+    char *message = malloc(len);
+    if (!message) {
+        return -1;
+    }
+    memcpy(message, &reply, sizeof(reply));
+    int32_t *positions = (int32_t *)(message + sizeof(reply));
+    for (int k = 0; k < result->count_hidden; ++k) {
+        positions[k] = htonl(result->key_positions[k]);
+    }
+
+    int status_io = scan_write_all(fd, message, len);
+    free(message);
+    return status_io;
+}
+
+int scan_net_serve(int fd, const int *data, int size, uint64_t input_hash) {
+    struct scan_result result;
+    scan_result_init(&result);
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    for (;;) {
+        struct scan_net_request request;
+        if (scan_read_all(fd, &request, sizeof(request)) == -1) {
+            scan_result_free(&result);
+            // The coordinator closing the connection is the normal way out.
+            return errno == ECONNRESET ? 0 : -1;
+        }
+
+        int input_size = ntohl(request.input_size);
+        int start = ntohl(request.start);
+        int end = ntohl(request.end);
+        uint64_t hash = (uint64_t)ntohl(request.hash_hi) << 32 | ntohl(request.hash_lo);
+        int status = SCAN_NET_OK;
+
+        if (ntohl(request.magic) != SCAN_NET_MAGIC || start < 0 || end < start) {
+            status = SCAN_NET_BAD_REQUEST;
+        } else if (input_size != size || end > size || (hash != 0 && hash != input_hash)) {
+            status = SCAN_NET_INPUT_MISMATCH;
+        } else if (scan_segment(data, start, end, &result) == -1) {
+            status = SCAN_NET_FAILED;
+        }
+
+        if (send_reply(fd, status, &result) == -1 || status == SCAN_NET_BAD_REQUEST) {
+            scan_result_free(&result);
+            return -1;
+        }
+    }
+}
+
+static int send_request(struct agent *agent, int size, uint64_t input_hash, int start, int end, int timeout_ms) {
+    struct scan_net_request request = {
+        .magic = htonl(SCAN_NET_MAGIC),
+        .input_size = htonl(size),
+        .start = htonl(start),
+        .end = htonl(end),
+        .hash_hi = htonl((uint32_t)(input_hash >> 32)),
+        .hash_lo = htonl((uint32_t)input_hash),
+    };
+    agent->deadline_ns = scan_progress_now_ns() + (int64_t)timeout_ms * 1000000;
+    return scan_write_all(agent->fd, &request, sizeof(request));
+}
+
+// Reads the reply for segment [start, end). Returns -1 with errno ESTALE
+// when the agent holds a different input, EPROTO for any malformed reply.
+static int receive_reply(int fd, int start, int end, struct scan_result *result) {
+    struct scan_net_reply reply;
+    if (scan_read_all(fd, &reply, sizeof(reply)) == -1) {
+        return -1;
+    }
+    int status = ntohl(reply.status);
+    if (ntohl(reply.magic) != SCAN_NET_MAGIC || status != SCAN_NET_OK) {
+        errno = ntohl(reply.magic) == SCAN_NET_MAGIC && status == SCAN_NET_INPUT_MISMATCH ? ESTALE : EPROTO;
+        return -1;
+    }
+
+    int count_hidden = ntohl(reply.count_hidden);
+    int count = ntohl(reply.count);
+    if (count != end - start || count_hidden < 0 || count_hidden > count || scan_result_reserve(result, count_hidden) == -1) {
+        errno = EPROTO;
+        return -1;
+    }
+    if (scan_read_all(fd, result->key_positions, count_hidden * sizeof(int32_t)) == -1) {
+        return -1;
+    }
+    // scan_result_merge() relies on ascending positions inside the segment.
+    for (int k = 0; k < count_hidden; ++k) {
+        int pos = ntohl(result->key_positions[k]);
+        if (pos < start || pos >= end || (k > 0 && pos <= result->key_positions[k - 1])) {
+            errno = EPROTO;
+            return -1;
+        }
+        result->key_positions[k] = pos;
+    }
+
+    result->count = count;
+    result->max = ntohl(reply.max);
+    result->sum = (int64_t)(((uint64_t)ntohl(reply.sum_hi) << 32) | ntohl(reply.sum_lo));
+    result->avg = count ? (double)result->sum / count : 0.0;
+    result->count_hidden = count_hidden;
+    return 0;
+}
+
+int scan_remote(const char **agents, int num_agents, int size, uint64_t input_hash, int num_segments, int timeout_ms,
+                struct scan_result *result, int *lost_agents) {
+    if (num_agents < 1 || num_segments < 1 || size < 0 || timeout_ms < 1) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct agent *pool = calloc(num_agents, sizeof(*pool));
+    struct pollfd *fds = calloc(num_agents, sizeof(*fds));
+    struct scan_result *results = calloc(num_segments, sizeof(*results));
+    int *pending = malloc(num_segments * sizeof(int));
+    if (!pool || !fds || !results || !pending) {
+        free(pool);
+        free(fds);
+        free(results);
+        free(pending);
+        return -1;
+    }
+
+    // Pending segments form a stack, filled so that they are handed out in order.
+    int num_pending = num_segments;
+    for (int i = 0; i < num_segments; ++i) {
+        pending[i] = num_segments - 1 - i;
+        scan_result_init(&results[i]);
+    }
+
+    int live = 0, lost = 0;
+    for (int a = 0; a < num_agents; ++a) {
+        pool[a].segment = -1;
+        pool[a].fd = scan_net_connect(agents[a]);
+        if (pool[a].fd == -1) {
+            fprintf(stderr, "Agent %s unreachable: %s\n", agents[a], strerror(errno));
+            lost++;
+        } else {
+            // Bounds the blocking reads of a reply that stalls half-way.
+            struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+            setsockopt(pool[a].fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            live++;
+        }
+    }
+
+    int done = 0, status = 0;
+    while (done < num_segments) {
+        // Hand a segment to every idle agent.
+        for (int a = 0; a < num_agents && num_pending > 0; ++a) {
+            if (pool[a].fd == -1 || pool[a].segment != -1) {
+                continue;
+            }
+            int segment = pending[--num_pending];
+            int start, end;
+            scan_segment_bounds(size, num_segments, segment, &start, &end);
+            pool[a].segment = segment;
+            if (send_request(&pool[a], size, input_hash, start, end, timeout_ms) == -1) {
+                fprintf(stderr, "Agent %s lost: %s\n", agents[a], strerror(errno));
+                pending[num_pending++] = segment;
+                close(pool[a].fd);
+                pool[a].fd = -1;
+                pool[a].segment = -1;
+                live--;
+                lost++;
+            }
+        }
+
+        if (live == 0) {
+            errno = EHOSTUNREACH;
+            status = -1;
+            break;
+        }
+
+        int64_t now = scan_progress_now_ns();
+        int64_t next_deadline = INT64_MAX;
+        int nfds = 0;
+        for (int a = 0; a < num_agents; ++a) {
+            fds[a].fd = pool[a].fd != -1 && pool[a].segment != -1 ? pool[a].fd : -1;
+            fds[a].events = POLLIN;
+            fds[a].revents = 0;
+            if (fds[a].fd != -1) {
+                nfds++;
+                if (pool[a].deadline_ns < next_deadline) {
+                    next_deadline = pool[a].deadline_ns;
+                }
+            }
+        }
+        if (nfds == 0) {
+            continue;
+        }
+
+        int wait_ms = next_deadline > now ? (int)((next_deadline - now) / 1000000) + 1 : 0;
+        if (poll(fds, num_agents, wait_ms) == -1 && errno != EINTR) {
+            status = -1;
+            break;
+        }
+
+        now = scan_progress_now_ns();
+        for (int a = 0; a < num_agents; ++a) {
+            if (fds[a].fd == -1) {
+                continue;
+            }
+            int segment = pool[a].segment;
+            const char *reason = NULL;
+
+            if (fds[a].revents & (POLLIN | POLLHUP | POLLERR)) {
+                int start, end;
+                scan_segment_bounds(size, num_segments, segment, &start, &end);
+                if (receive_reply(pool[a].fd, start, end, &results[segment]) == 0) {
+                    pool[a].segment = -1;
+                    done++;
+                    continue;
+                }
+                reason = errno == ESTALE ? "holds a different input" : strerror(errno);
+            } else if (now >= pool[a].deadline_ns) {
+                reason = "timed out";
+            } else {
+                continue;
+            }
+
+            // Drop the agent and put its segment back for the others.
+            fprintf(stderr, "Agent %s lost: %s\n", agents[a], reason);
+            pending[num_pending++] = segment;
+            close(pool[a].fd);
+            pool[a].fd = -1;
+            pool[a].segment = -1;
+            live--;
+            lost++;
+        }
+    }
+
+    if (status == 0) {
+        scan_result_free(result);
+        for (int i = 0; i < num_segments && status == 0; ++i) {
+            status = scan_result_merge(result, &results[i]);
+        }
+    }
+
+    for (int a = 0; a < num_agents; ++a) {
+        if (pool[a].fd != -1) {
+            close(pool[a].fd);
+        }
+    }
+    for (int i = 0; i < num_segments; ++i) {
+        scan_result_free(&results[i]);
+    }
+    free(pool);
+    free(fds);
+    free(results);
+    free(pending);
+
+    if (lost_agents) {
+        *lost_agents = lost;
+    }
+    return status;
+}
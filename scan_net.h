@@ -0,0 +1,70 @@
+#ifndef SCAN_NET_H
+#define SCAN_NET_H
+
+#include <stdint.h>
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Coordinator/agent protocol for scanning one input across several machines.
+// Every agent holds its own copy of the input; the coordinator hands out
+// segment ranges over TCP and merges the results that come back.
+#define SCAN_NET_DEFAULT_PORT 7450
+#define SCAN_NET_DEFAULT_TIMEOUT_MS 30000
+
+#define SCAN_NET_OK 0
+#define SCAN_NET_BAD_REQUEST 1
+#define SCAN_NET_INPUT_MISMATCH 2
+#define SCAN_NET_FAILED 3
+
+// All fields travel in network byte order.
+struct scan_net_request {
+    uint32_t magic;
+    int32_t input_size;         // must match the agent's input
+    int32_t start;
+    int32_t end;
+    uint32_t hash_hi;           // scan_hash_file() of the input, 0 if unchecked
+    uint32_t hash_lo;
+};
+
+// Followed by count_hidden int32 key positions.
+struct scan_net_reply {
+    uint32_t magic;
+    int32_t status;
+    int32_t count;
+    int32_t max;
+    uint32_t sum_hi;
+    uint32_t sum_lo;
+    int32_t count_hidden;
+};
+
+// Opens a listening socket on port (0 picks a free port, returned in
+// *bound_port).
+int scan_net_listen(int port, int *bound_port);
+
+// Connects to "host:port" (port defaults to SCAN_NET_DEFAULT_PORT).
+int scan_net_connect(const char *address);
+
+// Agent side: answers requests on fd against data until the peer closes.
+// Requests for an input of another size or content hash are refused.
+int scan_net_serve(int fd, const int *data, int size, uint64_t input_hash);
+
+// Coordinator side: splits [0, size) into num_segments balanced segments and
+// scans them on the agents, one outstanding segment per agent so faster
+// agents take more work. Segments held by an agent that disconnects, fails
+// or exceeds timeout_ms are re-assigned to the remaining agents. Fails only
+// when no agent is left. If lost_agents is not NULL it receives the number
+// of agents dropped along the way. Agents holding a different input (by
+// input_hash, unless it is 0) and replies that do not fit the segment asked
+// for count as failures.
+int scan_remote(const char **agents, int num_agents, int size, uint64_t input_hash, int num_segments, int timeout_ms,
+                struct scan_result *result, int *lost_agents);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
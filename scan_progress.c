@@ -0,0 +1,176 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "scan_progress.h"
+
+#define PROGRESS_MAGIC 0x50524f47u /* "PROG" */
+
+// Name removed by unlink_handler(); set once before the handlers go in.
+static char signal_name[256];
+
+const char *scan_progress_name(void) {
+    static char name[64];
+    const char *env = getenv(SCAN_PROGRESS_NAME_ENV);
+    if (env && *env) {
+        return env;
+    }
+    if (!name[0]) {
+        snprintf(name, sizeof(name), "%s%d", SCAN_PROGRESS_PREFIX, (int)getpid());
+    }
+    return name;
+}
+
+int64_t scan_progress_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct scan_progress *scan_progress_create(const char *name, int num_workers) {
+    if (num_workers < 0 || num_workers > SCAN_PROGRESS_MAX_WORKERS) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd == -1) {
+        return NULL;
+    }
+    if (ftruncate(fd, sizeof(struct scan_progress)) == -1) {
+        close(fd);
+        shm_unlink(name);
+        return NULL;
+    }
+
+    struct scan_progress *progress = mmap(NULL, sizeof(*progress), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (progress == MAP_FAILED) {
+        shm_unlink(name);
+        return NULL;
+    }
+
+    // Hide the segment from monitors until it is initialised.
+    progress->magic = 0;
+    memset(progress->workers, 0, sizeof(progress->workers));
+    progress->num_workers = num_workers;
+    progress->owner_pid = getpid();
+    atomic_store(&progress->finished, 0);
+    progress->start_ns = scan_progress_now_ns();
+    atomic_thread_fence(memory_order_release);
+    progress->magic = PROGRESS_MAGIC;
+    return progress;
+}
+
+static void unlink_handler(int sig) {
+    shm_unlink(signal_name);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+int scan_progress_unlink_on_signal(const char *name) {
+    int signals[] = {SIGINT, SIGTERM, SIGHUP};
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = unlink_handler;
+    sigemptyset(&action.sa_mask);
+
+    snprintf(signal_name, sizeof(signal_name), "%s", name);
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); ++i) {
+        if (sigaction(signals[i], &action, NULL) == -1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+const struct scan_progress *scan_progress_open(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(struct scan_progress)) {
+        close(fd);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    const struct scan_progress *progress = mmap(NULL, sizeof(*progress), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (progress == MAP_FAILED) {
+        return NULL;
+    }
+    if (progress->magic != PROGRESS_MAGIC) {
+        munmap((void *)progress, sizeof(*progress));
+        errno = EINVAL;
+        return NULL;
+    }
+    return progress;
+}
+
+void scan_progress_close(const struct scan_progress *progress) {
+    if (progress) {
+        munmap((void *)progress, sizeof(*progress));
+    }
+}
+
+void scan_progress_destroy(struct scan_progress *progress, const char *name) {
+    atomic_store_explicit(&progress->finished, 1, memory_order_release);
+    scan_progress_close(progress);
+    shm_unlink(name);
+}
+
+struct scan_progress_worker *scan_progress_worker(struct scan_progress *progress, int idx) {
+    if (!progress || idx < 0 || idx >= progress->num_workers) {
+        return NULL;
+    }
+    return &progress->workers[idx];
+}
+
+void scan_progress_begin(struct scan_progress_worker *worker, int64_t elements_total) {
+    if (!worker) {
+        return;
+    }
+    int64_t now = scan_progress_now_ns();
+    atomic_store_explicit(&worker->pid, getpid(), memory_order_relaxed);
+    atomic_store_explicit(&worker->elements_total, elements_total, memory_order_relaxed);
+    atomic_store_explicit(&worker->elements_scanned, 0, memory_order_relaxed);
+    atomic_store_explicit(&worker->keys_found, 0, memory_order_relaxed);
+    atomic_store_explicit(&worker->start_ns, now, memory_order_relaxed);
+    atomic_store_explicit(&worker->update_ns, now, memory_order_relaxed);
+    atomic_store_explicit(&worker->phase, SCAN_PHASE_SCAN, memory_order_relaxed);
+    atomic_store_explicit(&worker->state, SCAN_STATE_RUNNING, memory_order_release);
+}
+
+void scan_progress_update(struct scan_progress_worker *worker, int64_t elements_scanned, int64_t keys_found) {
+    if (!worker) {
+        return;
+    }
+    atomic_store_explicit(&worker->elements_scanned, elements_scanned, memory_order_relaxed);
+    atomic_store_explicit(&worker->keys_found, keys_found, memory_order_relaxed);
+    atomic_store_explicit(&worker->update_ns, scan_progress_now_ns(), memory_order_relaxed);
+}
+
+void scan_progress_set_phase(struct scan_progress_worker *worker, enum scan_progress_phase phase) {
+    if (worker) {
+        atomic_store_explicit(&worker->phase, phase, memory_order_relaxed);
+    }
+}
+
+void scan_progress_finish(struct scan_progress_worker *worker) {
+    if (!worker) {
+        return;
+    }
+    atomic_store_explicit(&worker->update_ns, scan_progress_now_ns(), memory_order_relaxed);
+    atomic_store_explicit(&worker->phase, SCAN_PHASE_NONE, memory_order_relaxed);
+    atomic_store_explicit(&worker->state, SCAN_STATE_DONE, memory_order_release);
+}
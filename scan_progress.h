@@ -0,0 +1,95 @@
+#ifndef SCAN_PROGRESS_H
+#define SCAN_PROGRESS_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Live progress counters published by scan workers into a named POSIX
+// shared-memory segment, read by the scanmon monitor. Each run gets its own
+// segment, SCAN_PROGRESS_PREFIX followed by the pid of the creating process.
+#define SCAN_PROGRESS_PREFIX "/datascan-progress."
+#define SCAN_PROGRESS_NAME_ENV "SCAN_PROGRESS_NAME"
+#define SCAN_PROGRESS_MAX_WORKERS 256
+#define SCAN_PROGRESS_CACHE_LINE 64
+// Elements scanned between two counter updates.
+#define SCAN_PROGRESS_CHUNK 16384
+
+enum scan_progress_state {
+    SCAN_STATE_IDLE,
+    SCAN_STATE_RUNNING,
+    SCAN_STATE_DONE,
+};
+
+enum scan_progress_phase {
+    SCAN_PHASE_NONE,
+    SCAN_PHASE_SCAN,
+    SCAN_PHASE_KEYS,
+    SCAN_PHASE_REPORT,
+};
+
+// One slot per worker, padded to a cache line so that workers updating
+// their own counters never contend on the same line.
+struct scan_progress_worker {
+    _Atomic int64_t elements_scanned;
+    _Atomic int64_t keys_found;
+    _Atomic int64_t elements_total;
+    _Atomic int64_t start_ns;
+    _Atomic int64_t update_ns;
+    _Atomic int32_t pid;
+    _Atomic int32_t phase;
+    _Atomic int32_t state;
+} __attribute__((aligned(SCAN_PROGRESS_CACHE_LINE)));
+
+struct scan_progress {
+    uint32_t magic;
+    int32_t num_workers;
+    int64_t start_ns;
+    int32_t owner_pid;          // process that created the segment
+    _Atomic int32_t finished;   // set by the owner when the run is over
+    struct scan_progress_worker workers[SCAN_PROGRESS_MAX_WORKERS];
+};
+
+// Name of this process's segment: $SCAN_PROGRESS_NAME, or
+// SCAN_PROGRESS_PREFIX<pid>. Forked workers keep their parent's name.
+const char *scan_progress_name(void);
+
+// Creates the segment for num_workers workers. Must be called before
+// forking so that the workers inherit the mapping. Returns NULL with errno
+// set on failure, EEXIST if another run already uses the name; callers then
+// run without counters rather than share them.
+struct scan_progress *scan_progress_create(const char *name, int num_workers);
+
+// Removes the segment name when the process is killed by SIGINT, SIGTERM or
+// SIGHUP, then lets the signal take its default action, so an interrupted
+// run does not leave a stale segment behind. Forked workers inherit it.
+int scan_progress_unlink_on_signal(const char *name);
+
+// Maps an existing segment read-only for monitoring.
+const struct scan_progress *scan_progress_open(const char *name);
+
+void scan_progress_close(const struct scan_progress *progress);
+
+// Marks the run finished, unmaps and removes the segment. Monitors that
+// already mapped it keep seeing the final counters.
+void scan_progress_destroy(struct scan_progress *progress, const char *name);
+
+// Returns the slot for worker idx, or NULL when progress is NULL or idx is
+// out of range. All update functions accept a NULL worker and do nothing.
+struct scan_progress_worker *scan_progress_worker(struct scan_progress *progress, int idx);
+
+void scan_progress_begin(struct scan_progress_worker *worker, int64_t elements_total);
+void scan_progress_update(struct scan_progress_worker *worker, int64_t elements_scanned, int64_t keys_found);
+void scan_progress_set_phase(struct scan_progress_worker *worker, enum scan_progress_phase phase);
+void scan_progress_finish(struct scan_progress_worker *worker);
+
+int64_t scan_progress_now_ns(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,171 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+#include <errno.h>
+
+#include "scan_sample.h"
+
+// Fewest blocks drawn from a stratum, so that it has a sample variance.
+#define MIN_STRATUM_BLOCKS 2
+
+struct stratum_state {
+    int start;
+    int64_t *order;             // block indices; the first sampled_blocks are the sample
+    struct scan_sample_stratum totals;
+};
+
+static uint64_t next_random(uint64_t *state) {
+    // xorshift64*
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545f4914f6cdd1dull;
+}
+
+void scan_estimate_init(struct scan_estimate *estimate) {
+    memset(estimate, 0, sizeof(*estimate));
+    estimate->max = INT_MIN;
+    estimate->exact = 1;
+}
+
+void scan_estimate_add(struct scan_estimate *estimate, const struct scan_sample_stratum *stratum) {
+    estimate->elements += stratum->elements;
+    estimate->sampled_elements += stratum->sampled_elements;
+    if (stratum->max > estimate->max) {
+        estimate->max = stratum->max;
+    }
+
+    int64_t m = stratum->sampled_blocks;
+    int64_t M = stratum->blocks;
+    if (m > 0) {
+        // Per-element rates scaled to the stratum size; block totals are the
+        // sampling units, with a finite-population correction.
+        double scale = (double)stratum->elements / stratum->sampled_elements;
+        estimate->total += stratum->sum * scale;
+        estimate->hidden += stratum->keys * scale;
+
+        if (m > 1 && m < M) {
+            double fpc = 1.0 - (double)m / M;
+            double var_sum = (stratum->sum_sq - stratum->sum * stratum->sum / m) / (m - 1);
+            double var_keys = (stratum->keys_sq - stratum->keys * stratum->keys / m) / (m - 1);
+            estimate->total_var += (double)M * M * fpc * var_sum / m;
+            estimate->hidden_var += (double)M * M * fpc * var_keys / m;
+        }
+    }
+    if (m < M) {
+        estimate->exact = 0;
+    }
+
+    estimate->avg = estimate->elements ? estimate->total / estimate->elements : 0.0;
+    estimate->avg_ci = estimate->elements ? SCAN_SAMPLE_Z95 * sqrt(estimate->total_var) / estimate->elements : 0.0;
+    estimate->hidden_ci = SCAN_SAMPLE_Z95 * sqrt(estimate->hidden_var);
+    if (estimate->hidden == 0.0 && !estimate->exact && estimate->sampled_elements > 0) {
+        // No key seen says little, and the variance would be 0: bound the count instead.
+        estimate->hidden_ci = SCAN_SAMPLE_RULE_OF_THREE * estimate->elements / estimate->sampled_elements;
+    }
+}
+
+// Draws blocks from the stratum until want of them have been sampled.
+static void sample_stratum(const int *data, int size, struct stratum_state *s, int64_t want, uint64_t *rng) {
+    struct scan_sample_stratum *t = &s->totals;
+
+    while (t->sampled_blocks < want) {
+        // Partial Fisher-Yates: pick one of the not-yet-sampled blocks.
+        int64_t i = t->sampled_blocks;
+        int64_t j = i + (int64_t)(next_random(rng) % (uint64_t)(t->blocks - i));
+        int64_t block = s->order[j];
+        s->order[j] = s->order[i];
+        s->order[i] = block;
+
+        int start = s->start + (int)(block * SCAN_SAMPLE_BLOCK);
+        int end = start + SCAN_SAMPLE_BLOCK;
+        int stratum_end = s->start + (int)t->elements;
+        if (end > stratum_end) end = stratum_end;
+        if (end > size) end = size;
+
+        int64_t sum = 0;
+        int keys = 0;
+        for (int k = start; k < end; ++k) {
+            if (data[k] > t->max) {
+                t->max = data[k];
+            }
+            if (SCAN_IS_HIDDEN_KEY(data[k])) {
+                keys++;
+            }
+            sum += data[k];
+        }
+
+        t->sampled_blocks++;
+        t->sampled_elements += end - start;
+        t->sum += sum;
+        t->sum_sq += (double)sum * sum;
+        t->keys += keys;
+        t->keys_sq += (double)keys * keys;
+    }
+}
+
+static int within_target(const struct scan_estimate *e, double target_error) {
+    return e->exact || (e->hidden > 0.0 && e->avg_ci <= target_error * fabs(e->avg) &&
+                        e->hidden_ci <= target_error * e->hidden);
+}
+
+int scan_sample(const int *data, int size, int num_segments, double fraction, double target_error,
+                uint64_t seed, struct scan_estimate *estimate) {
+    if (num_segments < 1 || size < 0 || fraction <= 0.0 || fraction > 1.0 || target_error < 0.0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    struct stratum_state *strata = calloc(num_segments, sizeof(*strata));
+    if (!strata) {
+        return -1;
+    }
+
+    int status = 0;
+    for (int idx = 0; idx < num_segments; ++idx) {
+        int start, end;
+        scan_segment_bounds(size, num_segments, idx, &start, &end);
+        struct stratum_state *s = &strata[idx];
+        s->start = start;
+        s->totals.elements = end - start;
+        s->totals.blocks = (end - start + SCAN_SAMPLE_BLOCK - 1) / SCAN_SAMPLE_BLOCK;
+        s->totals.max = INT_MIN;
+        s->order = malloc((s->totals.blocks > 0 ? s->totals.blocks : 1) * sizeof(int64_t));
+        if (!s->order) {
+            status = -1;
+            goto out;
+        }
+        for (int64_t b = 0; b < s->totals.blocks; ++b) {
+            s->order[b] = b;
+        }
+    }
+
+    uint64_t rng = seed ? seed : 0x9e3779b97f4a7c15ull;
+    for (;;) {
+        scan_estimate_init(estimate);
+        for (int idx = 0; idx < num_segments; ++idx) {
+            struct stratum_state *s = &strata[idx];
+            int64_t want = (int64_t)ceil(fraction * s->totals.blocks);
+            if (want < MIN_STRATUM_BLOCKS) want = MIN_STRATUM_BLOCKS;
+            if (want > s->totals.blocks) want = s->totals.blocks;
+
+            sample_stratum(data, size, s, want, &rng);
+            scan_estimate_add(estimate, &s->totals);
+        }
+
+        if (target_error <= 0.0 || within_target(estimate, target_error) || fraction >= 1.0) {
+            break;
+        }
+        fraction = fraction * 2 < 1.0 ? fraction * 2 : 1.0;
+    }
+
+out:
+    for (int idx = 0; idx < num_segments; ++idx) {
+        free(strata[idx].order);
+    }
+    free(strata);
+    return status;
+}
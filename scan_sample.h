@@ -0,0 +1,68 @@
+#ifndef SCAN_SAMPLE_H
+#define SCAN_SAMPLE_H
+
+#include <stdint.h>
+
+#include "datascan.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Approximate scans. Each segment of the balanced partition is a stratum;
+// within a stratum whole blocks of SCAN_SAMPLE_BLOCK consecutive elements
+// are drawn without replacement, so memory is still read sequentially and
+// the max of every sampled block is exact.
+#define SCAN_SAMPLE_BLOCK 64
+#define SCAN_SAMPLE_Z95 1.959964
+// 95% upper bound on the count of an event never seen in n trials is about
+// 3/n of the population ("rule of three").
+#define SCAN_SAMPLE_RULE_OF_THREE 3.0
+
+// Running totals for one stratum; strata are merged by adding their
+// contributions, the same way segment results are merged up the BFS tree.
+struct scan_sample_stratum {
+    int64_t elements;           // N_h
+    int64_t blocks;             // M_h
+    int64_t sampled_blocks;     // m_h
+    int64_t sampled_elements;
+    double sum;                 // sums over sampled blocks of block totals
+    double sum_sq;
+    double keys;                // ... and of block hidden-key counts
+    double keys_sq;
+    int max;
+};
+
+struct scan_estimate {
+    int64_t elements;
+    int64_t sampled_elements;
+    int max;                    // exact max over the sampled blocks (a lower bound)
+    int exact;                  // every element was sampled
+    double total;               // estimated sum and its variance
+    double total_var;
+    double hidden;              // estimated hidden-key count and its variance
+    double hidden_var;
+    double avg;
+    double avg_ci;              // 95% confidence half-widths
+    double hidden_ci;           // with no key sampled, a one-sided bound on the count
+};
+
+void scan_estimate_init(struct scan_estimate *estimate);
+
+// Adds a stratum's contribution to estimate and refreshes the derived
+// averages and confidence intervals.
+void scan_estimate_add(struct scan_estimate *estimate, const struct scan_sample_stratum *stratum);
+
+// Samples about fraction of the blocks of every stratum. If target_error is
+// positive, the sample is doubled until both the average and the hidden-key
+// estimate have a 95% half-width within target_error of their value (or
+// everything has been sampled); fraction is then only the starting point.
+// The target is never met before at least one hidden key has been sampled.
+int scan_sample(const int *data, int size, int num_segments, double fraction, double target_error,
+                uint64_t seed, struct scan_estimate *estimate);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+
+#include "datascan.h"
+#include "scan_net.h"
+#include "scan_cache.h"
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-i input] [-p port]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *input = "input.txt";
+    int port = SCAN_NET_DEFAULT_PORT;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:p:")) != -1) {
+        switch (opt) {
+        case 'i':
+            input = optarg;
+            break;
+        case 'p':
+            port = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind != argc || port < 0 || port > 65535) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int size;
+    int *data = scan_read_file(input, &size);
+    if (!data) {
+        perror("Error reading input");
+        exit(EXIT_FAILURE);
+    }
+
+    // Coordinators send the hash of their copy; requests for any other input are refused.
+    uint64_t input_hash;
+    if (scan_hash_file(input, &input_hash) == -1) {
+        perror("Error hashing input");
+        exit(EXIT_FAILURE);
+    }
+
+    int bound_port;
+    int listen_fd = scan_net_listen(port, &bound_port);
+    if (listen_fd == -1) {
+        perror("listen");
+        exit(EXIT_FAILURE);
+    }
+
+    // Connection handlers are reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+    printf("Agent %d serving %d elements from %s (content %016llx) on port %d\n", getpid(), size, input,
+           (unsigned long long)input_hash, bound_port);
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd == -1) {
+            perror("accept");
+            continue;
+        }
+
+        // One child per coordinator connection; the data is shared copy-on-write.
+        pid_t pid = fork();
+        if (pid == 0) {
+            close(listen_fd);
+            int status = scan_net_serve(fd, data, size, input_hash);
+            close(fd);
+            exit(status == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+        } else if (pid < 0) {
+            perror("fork");
+        }
+        close(fd);
+    }
+}
@@ -0,0 +1,105 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "datascan.h"
+#include "scan_net.h"
+#include "scan_cache.h"
+
+#define SEGMENTS_PER_AGENT 4
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-i input | -n size] [-s segments] [-t timeout-ms] [-k] host[:port]...\n", prog);
+}
+
+// Only the element count is needed here; the agents hold the data.
+static int read_size(const char *filename, int *size) {
+    FILE *file = fopen(filename, "r");
+    if (!file) {
+        return -1;
+    }
+    int ok = fscanf(file, "%d", size) == 1 && *size >= 0;
+    fclose(file);
+    return ok ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *input = "input.txt";
+    int input_given = 0;
+    int size = -1;
+    int segments = 0;
+    int timeout_ms = SCAN_NET_DEFAULT_TIMEOUT_MS;
+    int print_keys = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:n:s:t:k")) != -1) {
+        switch (opt) {
+        case 'i':
+            input = optarg;
+            input_given = 1;
+            break;
+        case 'n':
+            size = atoi(optarg);
+            break;
+        case 's':
+            segments = atoi(optarg);
+            break;
+        case 't':
+            timeout_ms = atoi(optarg);
+            break;
+        case 'k':
+            print_keys = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    int num_agents = argc - optind;
+    if (num_agents < 1 || segments < 0 || timeout_ms < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+    // Agents check the content hash of the input against their own copy.
+    // -n only overrides the size; with -n and no -i there is no file to
+    // hash, so just the size is checked.
+    uint64_t input_hash = 0;
+    int hash_input = input_given || size < 0;
+    if ((size < 0 && read_size(input, &size) == -1) || (hash_input && scan_hash_file(input, &input_hash) == -1)) {
+        fprintf(stderr, "Error reading %s\n", input);
+        return 1;
+    }
+    if (!hash_input) {
+        fprintf(stderr, "Warning: without -i, agents' inputs are only checked by size\n");
+    }
+    if (segments == 0) {
+        segments = num_agents * SEGMENTS_PER_AGENT;
+    }
+
+    struct scan_result result;
+    scan_result_init(&result);
+    int lost = 0;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+
+    if (scan_remote((const char **)&argv[optind], num_agents, size, input_hash, segments, timeout_ms, &result, &lost) == -1) {
+        perror("scan_remote");
+        exit(EXIT_FAILURE);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double time_spent = (end.tv_sec - begin.tv_sec) + (end.tv_nsec - begin.tv_nsec) / 1e9;
+
+    if (print_keys) {
+        for (int k = 0; k < result.count_hidden; ++k) {
+            printf("Hidden key in position A[%d].\n", result.key_positions[k]);
+        }
+    }
+    printf("Max=%d, Avg=%.2f, Sum=%lld, Hidden keys=%d\n", result.max, result.avg, (long long)result.sum, result.count_hidden);
+    printf("Agents: %d, lost: %d, segments: %d, time taken: %f seconds\n", num_agents, lost, segments, time_spent);
+
+    scan_result_free(&result);
+    return 0;
+}
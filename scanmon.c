@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "scan_progress.h"
+
+#define DEFAULT_INTERVAL_MS 500
+// A running worker is a straggler when its completed fraction is below
+// this share of the mean fraction across all workers.
+#define STRAGGLER_RATIO 0.5
+// Where Linux keeps POSIX shared-memory objects.
+#define SHM_DIR "/dev/shm"
+
+static const char *state_names[] = {"idle", "running", "done"};
+static const char *phase_names[] = {"-", "scan", "keys", "report"};
+
+struct sample {
+    int64_t elements_scanned;
+    int64_t update_ns;
+};
+
+static const char *lookup(const char **names, int count, int value) {
+    return value >= 0 && value < count ? names[value] : "?";
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n shm-name | -p pid] [-i interval-ms] [-c samples] [-b]\n"
+                    "Without -n or -p, attaches to $" SCAN_PROGRESS_NAME_ENV " or the most recently started run.\n",
+            prog);
+}
+
+static int process_gone(int pid) {
+    return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+}
+
+// Finds the newest per-run segment, so a bare scanmon follows the latest
+// scan. Segments left behind by runs that died are skipped.
+static int find_latest(char *name, size_t len) {
+    const char *prefix = SCAN_PROGRESS_PREFIX + 1; // without the leading '/'
+    DIR *dir = opendir(SHM_DIR);
+    if (!dir) {
+        return -1;
+    }
+
+    struct dirent *entry;
+    struct timespec newest = {0, 0};
+    int found = 0;
+    while ((entry = readdir(dir)) != NULL) {
+        char path[512];
+        struct stat st;
+        if (strncmp(entry->d_name, prefix, strlen(prefix)) != 0) {
+            continue;
+        }
+        int pid = atoi(entry->d_name + strlen(prefix));
+        if (process_gone(pid)) {
+            fprintf(stderr, "Skipping /%s: pid %d has exited\n", entry->d_name, pid);
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", SHM_DIR, entry->d_name);
+        if (stat(path, &st) == -1) {
+            continue;
+        }
+        if (!found || st.st_mtim.tv_sec > newest.tv_sec ||
+            (st.st_mtim.tv_sec == newest.tv_sec && st.st_mtim.tv_nsec > newest.tv_nsec)) {
+            newest = st.st_mtim;
+            snprintf(name, len, "/%s", entry->d_name);
+            found = 1;
+        }
+    }
+    closedir(dir);
+    return found ? 0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    const char *name = getenv(SCAN_PROGRESS_NAME_ENV);
+    char name_buf[256];
+    int interval_ms = DEFAULT_INTERVAL_MS;
+    int samples = -1;
+    int batch = 0; // no screen clearing, for logs and pipes
+    int status = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:p:i:c:b")) != -1) {
+        switch (opt) {
+        case 'n':
+            name = optarg;
+            break;
+        case 'p':
+            snprintf(name_buf, sizeof(name_buf), "%s%d", SCAN_PROGRESS_PREFIX, atoi(optarg));
+            name = name_buf;
+            break;
+        case 'i':
+            interval_ms = atoi(optarg);
+            break;
+        case 'c':
+            samples = atoi(optarg);
+            break;
+        case 'b':
+            batch = 1;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (interval_ms < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (!name || !*name) {
+        if (find_latest(name_buf, sizeof(name_buf)) == -1) {
+            fprintf(stderr, "No running scan found; pass -n or -p\n");
+            return 1;
+        }
+        name = name_buf;
+    }
+
+    const struct scan_progress *progress = scan_progress_open(name);
+    if (!progress) {
+        perror("Error opening progress segment");
+        return 1;
+    }
+
+    int num_workers = progress->num_workers;
+    struct sample *previous = calloc(num_workers > 0 ? num_workers : 1, sizeof(*previous));
+    if (!previous) {
+        perror("Malloc failed");
+        return 1;
+    }
+
+    struct timespec interval = {interval_ms / 1000, (interval_ms % 1000) * 1000000L};
+    for (int n = 0; samples < 0 || n < samples; ++n) {
+        int64_t now = scan_progress_now_ns();
+        double mean_fraction = 0.0;
+        int active = 0, done = 0;
+
+        for (int i = 0; i < num_workers; ++i) {
+            const struct scan_progress_worker *w = &progress->workers[i];
+            int64_t total = atomic_load_explicit(&w->elements_total, memory_order_relaxed);
+            int64_t scanned = atomic_load_explicit(&w->elements_scanned, memory_order_relaxed);
+            int state = atomic_load_explicit(&w->state, memory_order_acquire);
+            if (state != SCAN_STATE_IDLE) {
+                mean_fraction += total > 0 ? (double)scanned / total : 1.0;
+                active++;
+            }
+            done += state == SCAN_STATE_DONE;
+        }
+        mean_fraction = active ? mean_fraction / active : 0.0;
+
+        if (!batch) {
+            printf("\033[H\033[2J");
+        }
+        printf("%s  workers=%d done=%d elapsed=%.2fs\n", name, num_workers, done,
+               (now - progress->start_ns) / 1e9);
+        printf("%4s %8s %-8s %-6s %12s %12s %7s %12s %8s\n",
+               "slot", "pid", "state", "phase", "scanned", "total", "pct", "elem/s", "keys");
+
+        for (int i = 0; i < num_workers; ++i) {
+            const struct scan_progress_worker *w = &progress->workers[i];
+            int state = atomic_load_explicit(&w->state, memory_order_acquire);
+            if (state == SCAN_STATE_IDLE) {
+                continue;
+            }
+            int64_t total = atomic_load_explicit(&w->elements_total, memory_order_relaxed);
+            int64_t scanned = atomic_load_explicit(&w->elements_scanned, memory_order_relaxed);
+            int64_t keys = atomic_load_explicit(&w->keys_found, memory_order_relaxed);
+            int64_t update_ns = atomic_load_explicit(&w->update_ns, memory_order_relaxed);
+            int64_t start_ns = atomic_load_explicit(&w->start_ns, memory_order_relaxed);
+            int phase = atomic_load_explicit(&w->phase, memory_order_relaxed);
+            double fraction = total > 0 ? (double)scanned / total : 1.0;
+
+            // Throughput since the previous sample, or over the whole run for the first
+            // one and whenever the slot was restarted by a new run.
+            int restarted = !previous[i].update_ns || scanned < previous[i].elements_scanned;
+            int64_t base_scanned = restarted ? 0 : previous[i].elements_scanned;
+            int64_t base_ns = restarted ? start_ns : previous[i].update_ns;
+            double rate = update_ns > base_ns ? (scanned - base_scanned) * 1e9 / (update_ns - base_ns) : 0.0;
+            previous[i].elements_scanned = scanned;
+            previous[i].update_ns = update_ns;
+
+            int straggler = state == SCAN_STATE_RUNNING && fraction < mean_fraction * STRAGGLER_RATIO;
+            printf("%4d %8d %-8s %-6s %12lld %12lld %6.1f%% %12.0f %8lld%s\n", i,
+                   atomic_load_explicit(&w->pid, memory_order_relaxed),
+                   lookup(state_names, 3, state), lookup(phase_names, 4, phase),
+                   (long long)scanned, (long long)total, fraction * 100.0, rate, (long long)keys,
+                   straggler ? "  <- straggler" : "");
+        }
+        fflush(stdout);
+
+        if (atomic_load_explicit(&progress->finished, memory_order_acquire) || (num_workers > 0 && done == num_workers)) {
+            break;
+        }
+        if (process_gone(progress->owner_pid)) {
+            fprintf(stderr, "Run %d exited without finishing\n", progress->owner_pid);
+            status = 1;
+            break;
+        }
+        nanosleep(&interval, NULL);
+    }
+
+    free(previous);
+    scan_progress_close(progress);
+    return status;
+}
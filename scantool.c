@@ -0,0 +1,312 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "datascan.h"
+#include "scan_checkpoint.h"
+#include "scan_cache.h"
+#include "scan_sample.h"
+#include "scan_index.h"
+#include "scan_exec.h"
+
+#define DEFAULT_SEGMENTS 8
+#define DEFAULT_SAMPLE_FRACTION 0.01
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-i input] [-s segments] [-k] [-a] [-m mode] [-f fraction] [-e error] [-v value] [-l limit] <command>\n"
+            "Commands:\n"
+            "  scan         scan the whole input; with -m auto|serial|flat|tree|threads, run it\n"
+            "               in that mode with -s workers (auto picks both from the cost model)\n"
+            "  incremental  rescan only segments changed since the last run (<input>" SCAN_CHECKPOINT_SUFFIX ");\n"
+            "               with -a, assume the input was only appended to and skip hashing\n"
+            "  approx       estimate from a stratified sample of -f of each segment, or\n"
+            "               until the 95%% intervals are within relative error -e\n"
+            "  index        scan and save the key index (<input>" SCAN_INDEX_SUFFIX ")\n"
+            "  lookup       all positions of key -v, from the index\n"
+            "  first        the first -l keys in position order, from the index\n"
+            "  calibrate    remeasure the cost model used by -m auto\n",
+            prog);
+}
+
+static void print_result(FILE *out, const int *data, const struct scan_result *result, int print_keys) {
+    if (print_keys) {
+        for (int k = 0; k < result->count_hidden; ++k) {
+            int i = result->key_positions[k];
+            fprintf(out, "I found the hidden key %d in position A[%d].\n", data[i], i);
+        }
+    }
+    fprintf(out, "Max=%d, Avg=%.2f, Sum=%lld, Hidden keys=%d\n", result->max, result->avg, (long long)result->sum, result->count_hidden);
+}
+
+// Starting fraction for an error target; scan_sample() doubles it as needed.
+static double fraction_for_error(double target_error) {
+    double fraction = target_error * target_error;
+    return fraction > DEFAULT_SAMPLE_FRACTION ? DEFAULT_SAMPLE_FRACTION : fraction;
+}
+
+// Scans the input and saves its key index; the index is built from the key
+// positions the scan collects.
+static int build_index(const char *input, const char *index_path, int segments, struct scan_index *index) {
+    int size;
+    int *data = scan_read_file(input, &size);
+    if (!data) {
+        return -1;
+    }
+
+    struct scan_result result;
+    scan_result_init(&result);
+    int status = scan_data(data, size, segments, &result) == -1 ||
+                 scan_index_build(data, size, &result, index) == -1 ||
+                 scan_index_save(index_path, input, index) == -1 ? -1 : 0;
+
+    scan_result_free(&result);
+    free(data);
+    return status;
+}
+
+static int run_index_command(const char *command, const char *input, int segments, int value, int limit) {
+    char index_path[4096];
+    snprintf(index_path, sizeof(index_path), "%s%s", input, SCAN_INDEX_SUFFIX);
+
+    struct scan_index index;
+    scan_index_init(&index);
+    clock_t begin = clock();
+
+    // A missing, corrupt or stale index is rebuilt rather than trusted.
+    int loaded = strcmp(command, "index") != 0 && scan_index_load(index_path, input, &index) == 0;
+    if (!loaded && build_index(input, index_path, segments, &index) == -1) {
+        perror("Error building index");
+        return 1;
+    }
+
+    if (strcmp(command, "index") == 0) {
+        printf("Indexed %d hidden keys of %d elements into %s\n", index.all.count, index.size, index_path);
+    } else if (strcmp(command, "lookup") == 0) {
+        int count = scan_index_count(&index, value);
+        int *positions = malloc((count > 0 ? count : 1) * sizeof(int));
+        if (!positions) {
+            perror("Malloc failed");
+            return 1;
+        }
+        count = scan_index_lookup(&index, value, positions, count);
+        for (int k = 0; k < count; ++k) {
+            printf("Hidden key %d in position A[%d].\n", value, positions[k]);
+        }
+        printf("Found %d positions of %d.\n", count, value);
+        free(positions);
+    } else {
+        int *positions = malloc((limit > 0 ? limit : 1) * sizeof(int));
+        int *values = malloc((limit > 0 ? limit : 1) * sizeof(int));
+        if (!positions || !values) {
+            perror("Malloc failed");
+            return 1;
+        }
+        int count = scan_index_first(&index, limit, positions, values);
+        for (int k = 0; k < count; ++k) {
+            printf("Hidden key %d in position A[%d].\n", values[k], positions[k]);
+        }
+        printf("Found %d of %d requested keys.\n", count, limit);
+        free(positions);
+        free(values);
+    }
+
+    printf("%s, time taken: %f seconds\n", loaded ? "Index hit" : "Index built",
+           (double)(clock() - begin) / CLOCKS_PER_SEC);
+    scan_index_free(&index);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *input = "input.txt";
+    int segments = DEFAULT_SEGMENTS;
+    int print_keys = 0;
+    double fraction = 0.0;
+    double target_error = 0.0;
+    int value = 0;
+    int limit = 0;
+    int append_only = 0;
+    const char *mode_name = NULL;
+    enum scan_exec_mode mode = SCAN_EXEC_AUTO;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "i:s:kam:f:e:v:l:")) != -1) {
+        switch (opt) {
+        case 'i':
+            input = optarg;
+            break;
+        case 's':
+            segments = atoi(optarg);
+            break;
+        case 'k':
+            print_keys = 1;
+            break;
+        case 'a':
+            append_only = 1;
+            break;
+        case 'm':
+            mode_name = optarg;
+            break;
+        case 'f':
+            fraction = atof(optarg);
+            break;
+        case 'e':
+            target_error = atof(optarg);
+            break;
+        case 'v':
+            value = atoi(optarg);
+            break;
+        case 'l':
+            limit = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || segments < 1 || fraction < 0.0 || fraction > 1.0 || target_error < 0.0 ||
+        (mode_name && scan_exec_parse_mode(mode_name, &mode) == -1)) {
+        usage(argv[0]);
+        return 1;
+    }
+    const char *command = argv[optind];
+
+    if (strcmp(command, "calibrate") == 0) {
+        struct scan_cost_model model;
+        if (scan_cost_model_get(&model, 1) == -1) {
+            perror("scan_calibrate");
+            exit(EXIT_FAILURE);
+        }
+        printf("Host %s, %d cores\n", model.host, model.cores);
+        printf("Scan %.3f ns/element, fork %.0f ns + %.0f ns/MiB, pipe message %.0f ns, thread %.0f ns\n",
+               model.scan_ns_per_element, model.fork_ns, model.fork_ns_per_mb, model.pipe_ns, model.thread_ns);
+        return 0;
+    }
+
+    if (strcmp(command, "index") == 0 || strcmp(command, "lookup") == 0 || strcmp(command, "first") == 0) {
+        if ((strcmp(command, "lookup") == 0 && !SCAN_IS_HIDDEN_KEY(value)) || (strcmp(command, "first") == 0 && limit < 1)) {
+            usage(argv[0]);
+            return 1;
+        }
+        return run_index_command(command, input, segments, value, limit);
+    }
+
+    struct scan_result result;
+    scan_result_init(&result);
+    clock_t begin = clock();
+
+    // Full scans are served from the result cache when SCAN_CACHE is set. The
+    // segment count does not change the result, so it is not part of the key.
+    struct scan_cache cache = {.mode = SCAN_CACHE_OFF};
+    struct scan_cache_key cache_key;
+    if (strcmp(command, "scan") == 0) {
+        if (scan_cache_from_env(&cache) == -1 ||
+            (cache.mode != SCAN_CACHE_OFF && scan_cache_key(&cache, input, "scantool-scan", &print_keys, 1, &cache_key) == -1)) {
+            perror("Warning: result cache disabled");
+            cache.mode = SCAN_CACHE_OFF;
+        }
+
+        char *report;
+        if (scan_cache_get(&cache, &cache_key, &result, &report, NULL) == 1) {
+            fputs(report, stdout);
+            printf("Cache hit, time taken: %f seconds\n", (double)(clock() - begin) / CLOCKS_PER_SEC);
+            free(report);
+            scan_result_free(&result);
+            return 0;
+        }
+    }
+
+    int size;
+    int *data = scan_read_file(input, &size);
+    if (!data) {
+        perror("Error reading input");
+        exit(EXIT_FAILURE);
+    }
+
+    if (strcmp(command, "scan") == 0 && mode_name) {
+        // clock() does not see forked workers, so report wall time as well.
+        struct timespec wall_begin, wall_end;
+        clock_gettime(CLOCK_MONOTONIC, &wall_begin);
+        if (scan_exec(data, size, &mode, &segments, &result) == -1) {
+            perror("scan_exec");
+            exit(EXIT_FAILURE);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &wall_end);
+        printf("Mode %s with %d workers, wall time %f seconds\n", scan_exec_mode_name(mode), segments,
+               (wall_end.tv_sec - wall_begin.tv_sec) + (wall_end.tv_nsec - wall_begin.tv_nsec) / 1e9);
+    } else if (strcmp(command, "scan") == 0) {
+        if (scan_data(data, size, segments, &result) == -1) {
+            perror("scan_data");
+            exit(EXIT_FAILURE);
+        }
+    } else if (strcmp(command, "incremental") == 0) {
+        char checkpoint_path[4096];
+        snprintf(checkpoint_path, sizeof(checkpoint_path), "%s%s", input, SCAN_CHECKPOINT_SUFFIX);
+
+        int rescanned = 0;
+        if ((append_only ? scan_incremental_append : scan_incremental)(data, size, checkpoint_path, &result, &rescanned) == -1) {
+            perror("scan_incremental");
+            exit(EXIT_FAILURE);
+        }
+        int total = (size + SCAN_CHECKPOINT_SEGMENT_SIZE - 1) / SCAN_CHECKPOINT_SEGMENT_SIZE;
+        printf("Rescanned %d of %d segments.\n", rescanned, total);
+    } else if (strcmp(command, "approx") == 0) {
+        if (fraction == 0.0) {
+            fraction = target_error > 0.0 ? fraction_for_error(target_error) : DEFAULT_SAMPLE_FRACTION;
+        }
+
+        struct scan_estimate estimate;
+        clock_t sample_begin = clock();
+        if (scan_sample(data, size, segments, fraction, target_error, (uint64_t)time(NULL) ^ getpid(), &estimate) == -1) {
+            perror("scan_sample");
+            exit(EXIT_FAILURE);
+        }
+        clock_t sample_end = clock();
+        double time_spent = (double)(sample_end - begin) / CLOCKS_PER_SEC;
+
+        printf("Sampled %lld of %lld elements (%.2f%%) in %d strata%s\n", (long long)estimate.sampled_elements,
+               (long long)estimate.elements, estimate.elements ? 100.0 * estimate.sampled_elements / estimate.elements : 0.0,
+               segments, estimate.exact ? ", exact" : "");
+        printf("Max>=%d (exact over sampled blocks), Avg=%.2f +/- %.2f, ", estimate.max, estimate.avg, estimate.avg_ci);
+        if (estimate.hidden == 0.0 && !estimate.exact) {
+            printf("Hidden keys<=%.0f (none sampled, 95%%)\n", estimate.hidden_ci);
+        } else {
+            printf("Hidden keys=%.0f +/- %.0f (95%%)\n", estimate.hidden, estimate.hidden_ci);
+        }
+        printf("Time taken: %f seconds (sampling %f seconds)\n", time_spent,
+               (double)(sample_end - sample_begin) / CLOCKS_PER_SEC);
+        free(data);
+        return 0;
+    } else {
+        usage(argv[0]);
+        return 1;
+    }
+
+    double time_spent = (double)(clock() - begin) / CLOCKS_PER_SEC;
+    if (cache.mode != SCAN_CACHE_OFF) {
+        char *report = NULL;
+        size_t report_len = 0;
+        FILE *out = open_memstream(&report, &report_len);
+        if (!out) {
+            perror("open_memstream");
+            exit(EXIT_FAILURE);
+        }
+        print_result(out, data, &result, print_keys);
+        fclose(out);
+        if (scan_cache_put(&cache, &cache_key, &result, report, report_len) == -1) {
+            perror("Warning: could not store result in cache");
+        }
+        fputs(report, stdout);
+        free(report);
+    } else {
+        print_result(stdout, data, &result, print_keys);
+    }
+    printf("Time taken: %f seconds\n", time_spent);
+
+    scan_result_free(&result);
+    free(data);
+    return 0;
+}